@@ -7,19 +7,31 @@
 #include <string>
 #include <library/msufsort.h>
 #include <iomanip>
+#include <cstring>
+#include <memory>
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
 
 
 namespace
 {
 
+    using suffix_index = ::maniscalco::msufsort::suffix_index;
+
+
     //==============================================================================
-    inline int32_t match_length
+    inline suffix_index match_length
     (
         int8_t const * beginInput,
         int8_t const * endInput,
-        int32_t indexA,
-        int32_t indexB,
-        int32_t matchLength
+        suffix_index indexA,
+        suffix_index indexB,
+        suffix_index matchLength
     )
     {
         if (indexA > indexB)
@@ -38,87 +50,23 @@ namespace
 
 
     //==============================================================================
-    void lcp
-    (
-        int8_t const * beginInput,
-        int8_t const * endInput,
-        int32_t * begin,
-        int32_t size,
-        std::size_t currentMatchLength
-    )
-    {
-        if (size <= 4)
-        {
-            for (auto i = 0; i < size; ++i)
-                begin[i] = match_length(beginInput, endInput, begin[i], begin[i + 1], currentMatchLength);
-        }
-        else
-        {
-            auto mid = (size / 2);
-            auto nextMatchLength = match_length(beginInput, endInput, begin[0], begin[mid], currentMatchLength);
-            lcp(beginInput, endInput, begin, mid, nextMatchLength);
-            lcp(beginInput, endInput, begin + mid, size - mid, currentMatchLength);
-        }
-    }
-
-
-    //==============================================================================
-    void lcp_multithreaded
-    (
-        int8_t const * beginInput,
-        int8_t const * endInput,
-        int32_t * begin,
-        int32_t size,
-        int32_t numThreads
-    )
-    {
-        auto perThread = ((size + numThreads - 1) / numThreads);
-        std::vector<std::thread> threads(numThreads);
-        int32_t temp[numThreads];
-
-        auto n = 0;
-        for (auto i = 0; i < numThreads; ++i)
-        {
-            auto s = perThread;
-            if ((n + s) > size)
-                s = (size - n);
-            temp[i] = match_length(beginInput, endInput, begin[n + s - 1], begin[n + s], 0);
-            threads[i] = std::thread(lcp, beginInput, endInput, begin + n, s - 1, 0);
-            n += s;
-        }
-
-        for (auto & e : threads)
-            e.join();
-        n = 0;
-        for (auto i = 0; i < numThreads; ++i)
-        {
-            auto s = perThread;
-            if ((n + s) > size)
-                s = (size - n);
-            begin[n + s - 1] = temp[i];
-            n += s;
-        }
-    }
-
-
-
-    //==============================================================================
-    void validate_lcp
+    bool validate_lcp
     (
         int8_t const * beginInput,
         int8_t const * endInput,
-        int32_t const * sa,
-        int32_t size,
-        int32_t const * lcp
+        suffix_index const * sa,
+        suffix_index const * lcp
     )
     {
-        auto numSuffixes = size;
+        suffix_index numSuffixes = std::distance(beginInput, endInput);
         auto errorCount = 0;
         auto updateInterval = ((numSuffixes + 99) / 100);
-        auto nextUpdate = 0;
-        auto counter = 0;
+        int64_t nextUpdate = 0;
+        int64_t counter = 0;
 
-        for (auto i = 0; i < size; ++i)
+        if (lcp[0] != 0)
+            errorCount++;
+        for (suffix_index i = 1; i <= numSuffixes; ++i)
         {
             if (counter++ >= nextUpdate)
             {
@@ -128,7 +76,7 @@ namespace
                 std::cout << (counter / updateInterval) << "% verified" << (char)13 << std::flush;
             }
 
-            auto m = match_length(beginInput, endInput, sa[i], sa[i + 1], 0);
+            auto m = match_length(beginInput, endInput, sa[i - 1], sa[i], 0);
             if (m != lcp[i])
                 errorCount++;
         }
@@ -136,53 +84,41 @@ namespace
             std::cout << "lcp array error count = " << errorCount << std::endl;
         else
             std::cout << "lcp array validated" << std::endl;
+        return (errorCount == 0);
     }
 
 
     //==========================================================================
-    void make_lcp_array
+    bool make_lcp_array
     (
-            std::vector<int32_t> const & suffixArray,
-            std::vector<int8_t> const & input,
-        int32_t numThreads
+        ::maniscalco::msufsort::suffix_array & suffixArray,
+        int8_t const * beginInput,
+        int8_t const * endInput,
+        int32_t numThreads,
+        bool validate
     )
     {
-        // lcp can be computed using the existing suffix array space but we make a copy instead
-        // so that we can validate the lcp using the suffix array.
-        std::vector<int32_t> output(suffixArray.begin() + 1, suffixArray.end());
+        // the lcp array overwrites the suffix array unless a copy of the suffix array
+        // is required to validate the lcp array.  returns false if validation fails.
         auto start = std::chrono::system_clock::now();
-        lcp_multithreaded(input.data(), input.data() + input.size(), output.data(), output.size(), numThreads);
-        auto finish = std::chrono::system_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
-        std::cout << "lcp array completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
-        validate_lcp(input.data(), input.data() + input.size(), suffixArray.data() + 1, suffixArray.size() - 1, output.data());
-    }
-
-
-    //==============================================================================
-    std::vector<int8_t> load_file
-    (
-        std::string const & inputPath
-    )
-    {
-        std::vector<int8_t> input;
-        std::ifstream inputStream(inputPath, std::ios_base::in | std::ios_base::binary);
-        if (inputStream)
+        if (validate)
         {
-            inputStream.seekg(0, std::ios_base::end);
-            int64_t size = inputStream.tellg();
-            input.reserve(size);
-            input.resize(size);
-            inputStream.seekg(0, std::ios_base::beg);
-            inputStream.read((char *)input.data(), input.size());
-            inputStream.close();
+            auto lcpArray = ::maniscalco::make_lcp_array(beginInput, endInput, suffixArray.data(), numThreads);
+            auto finish = std::chrono::system_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
+            std::cout << "lcp array completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
+            auto valid = validate_lcp(beginInput, endInput, suffixArray.data(), lcpArray.data());
+            suffixArray.swap(lcpArray);
+            return valid;
         }
         else
         {
-            std::cout << "failed to load file: " << inputPath << std::endl;
-            throw std::exception();
+            ::maniscalco::make_lcp_array(beginInput, endInput, suffixArray.data(), suffixArray.data(), numThreads);
+            auto finish = std::chrono::system_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
+            std::cout << "lcp array completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
+            return true;
         }
-        return input;
     }
 
 
@@ -198,14 +134,127 @@ namespace
         std::ofstream outputStream(outputPath, std::ios_base::out | std::ios_base::binary);
         if (outputStream)
         {
-            outputStream.write((char const *)&*begin, std::distance(begin, end));
+            outputStream.write((char const *)&*begin, std::distance(begin, end) * sizeof(*begin));
             outputStream.close();
-            return true;
+            return (!outputStream.fail());
         }
         return false;
     }
 
 
+    //==============================================================================
+    // a file mapped into memory.  input files are mapped copy on write so that the bwt can be
+    // computed in place without modifying the file.  output files are created at their final 
+    // size and written through the mapping.  without mmap the file is read into (or written 
+    // from) a buffer instead.
+    class mapped_file
+    {
+    public:
+
+        enum mode_type
+        {
+            input,
+            output
+        };
+
+        mapped_file
+        (
+            std::string const & path,
+            mode_type mode,
+            std::size_t size = 0
+        ):
+            path_(path),
+            mode_(mode),
+            data_(nullptr),
+            size_(size)
+        {
+            #ifdef __linux__
+                auto fileDescriptor = (mode_ == input) ? ::open(path_.c_str(), O_RDONLY) : ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if (fileDescriptor < 0)
+                {
+                    std::cout << "failed to open file: " << path_ << std::endl;
+                    throw std::exception();
+                }
+                struct stat fileStatus;
+                if (mode_ == input)
+                {
+                    size_ = ((::fstat(fileDescriptor, &fileStatus) == 0) ? fileStatus.st_size : 0);
+                }
+                else if (::ftruncate(fileDescriptor, size_) != 0)
+                {
+                    ::close(fileDescriptor);
+                    std::cout << "failed to size file: " << path_ << std::endl;
+                    throw std::exception();
+                }
+                if (size_ > 0)
+                {
+                    auto address = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, (mode_ == input) ? MAP_PRIVATE : MAP_SHARED, fileDescriptor, 0);
+                    if (address == MAP_FAILED)
+                    {
+                        ::close(fileDescriptor);
+                        std::cout << "failed to map file: " << path_ << std::endl;
+                        throw std::exception();
+                    }
+                    data_ = (int8_t *)address;
+                    if (mode_ == input)
+                        ::madvise(address, size_, MADV_WILLNEED);
+                }
+                ::close(fileDescriptor);
+            #else
+                if (mode_ == input)
+                {
+                    std::ifstream inputStream(path_, std::ios_base::in | std::ios_base::binary);
+                    if (!inputStream)
+                    {
+                        std::cout << "failed to load file: " << path_ << std::endl;
+                        throw std::exception();
+                    }
+                    inputStream.seekg(0, std::ios_base::end);
+                    size_ = inputStream.tellg();
+                    buffer_.resize(size_);
+                    inputStream.seekg(0, std::ios_base::beg);
+                    inputStream.read((char *)buffer_.data(), buffer_.size());
+                }
+                else
+                {
+                    buffer_.resize(size_);
+                }
+                data_ = buffer_.data();
+            #endif
+        }
+
+        ~mapped_file
+        (
+        )
+        {
+            #ifdef __linux__
+                if (data_ != nullptr)
+                    ::munmap(data_, size_);
+            #else
+                if (mode_ == output)
+                    write_file(path_, buffer_.begin(), buffer_.end());
+            #endif
+        }
+
+        mapped_file(mapped_file const &) = delete;
+        mapped_file & operator = (mapped_file const &) = delete;
+
+        int8_t * begin() const{return data_;}
+
+        int8_t * end() const{return (data_ + size_);}
+
+        std::size_t size() const{return size_;}
+
+    private:
+
+        std::string         path_;
+        mode_type           mode_;
+        int8_t *            data_;
+        std::size_t         size_;
+        std::vector<int8_t> buffer_;
+    };
+
+
     //==============================================================================
     template <typename InputIter>
     int compare
@@ -235,20 +284,22 @@ namespace
     //==============================================================================
     int32_t validate_suffix_array
     (
-        std::vector<int8_t> const & input,
-        std::vector<int32_t> const & suffixArray
+        int8_t const * beginInput,
+        int8_t const * endInput,
+        suffix_index const * suffixArray
     )
     {
-        if (suffixArray[0] != (int32_t)input.size())
+        suffix_index inputSize = std::distance(beginInput, endInput);
+        if (suffixArray[0] != inputSize)
             return 1; // first entry in SA should be sentinel
 
-        auto numSuffixes = input.size();
+        auto numSuffixes = inputSize;
         auto errorCount = 0;
         auto updateInterval = ((numSuffixes + 99) / 100);
-        auto nextUpdate = 0;
-        auto counter = 0;
+        int64_t nextUpdate = 0;
+        int64_t counter = 0;
 
-        for (auto i = 2; i < (int32_t)suffixArray.size(); ++i)
+        for (suffix_index i = 2; i <= inputSize; ++i)
         {
             if (counter++ >= nextUpdate)
             {
@@ -258,9 +309,9 @@ namespace
                 std::cout << (counter / updateInterval) << "% verified" << (char)13 << std::flush;
             }
 
-            auto suffixA = input.data() + suffixArray[i - 1];
-            auto suffixB = input.data() + suffixArray[i];
-            int32_t c = compare(suffixA, suffixB, input.data() + input.size());
+            auto suffixA = beginInput + suffixArray[i - 1];
+            auto suffixB = beginInput + suffixArray[i];
+            int32_t c = compare(suffixA, suffixB, endInput);
             if (c != -1)
             {
                 ++errorCount;
@@ -295,13 +346,17 @@ namespace
         std::cout << "msufsort - version 4a-demo" << std::endl;
         std::cout << "author: Michael A Maniscalco" << std::endl;
         std::cout << "**** this is a pre-release demo ****" << std::endl;
-        std::cout << "**** this version is incomplete and lacks induction sorting ****" << std::endl;
         std::cout << "================================================================" << std::endl << std::endl;
 
-        std::cout << "usage: msufsort [b|s|l] input [num threads]" << std::endl;
+        std::cout << "usage: msufsort [b|s|l] input [num threads] [output] [-n]" << std::endl;
         std::cout << "\tb = bwt" << std::endl;
         std::cout << "\ts = suffix array" << std::endl;
         std::cout << "\tl = lcp array" << std::endl;
+        std::cout << "\toutput = file to write the result to.  the bwt is written as the sentinel index followed by" << std::endl;
+        std::cout << "\t         the transformed input.  the suffix and lcp arrays are written as arrays of suffix" << std::endl;
+        std::cout << "\t         indexes.  lcp[i] is the common prefix length of the suffixes at sa[i - 1] and sa[i]." << std::endl;
+        std::cout << "\t         all values are in host byte order." << std::endl;
+        std::cout << "\t-n = skip validation of the result" << std::endl;
     }
 
 }
@@ -314,12 +369,14 @@ int32_t main
     char const ** inputArguments
 )
 {
+    // non zero on any failure to compute, validate or write the result
+    int32_t exitCode = 0;
     try
     {
         if (argumentCount < 3)
         {
             print_usage();
-            return 0;
+            return 1;
         }
 
         enum task_type
@@ -345,24 +402,42 @@ int32_t main
         if (taskType == invalid)
         {
             print_usage();
-            return 0;
+            return 1;
         }
 
+        // optional arguments which follow the input path: [num threads] [output] [-n]
+        bool validate = true;
+        std::vector<std::string> arguments;
+        for (auto i = 3; i < argumentCount; ++i)
+        {
+            std::string argument(inputArguments[i]);
+            if (argument == "-n")
+                validate = false;
+            else
+                arguments.push_back(argument);
+        }
+        std::string outputPath = (arguments.size() >= 2) ? arguments[1] : std::string();
+
         std::string inputPath = inputArguments[2];
-        std::vector<int8_t> input;
+        std::unique_ptr<mapped_file> input;
         if (taskType != test_mode)
         {
-            input = load_file(inputPath);
+            input.reset(new mapped_file(inputPath, mapped_file::input));
 
-            int32_t inputSize = input.size();
+            int64_t inputSize = input->size();
             std::cout << "================================================================" << std::endl;
             std::cout << "msufsort - version 4a-demo" << std::endl;
             std::cout << "author: Michael A Maniscalco" << std::endl;
             std::cout << "**** this is a pre-release demo ****" << std::endl;
-            std::cout << "**** this version is incomplete and lacks induction sorting ****" << std::endl;
             std::cout << "================================================================" << std::endl << std::endl;
 
             std::cout << "loaded " << inputSize << " bytes" << std::endl;
+            if (inputSize > ::maniscalco::msufsort::max_input_size)
+            {
+                std::cout << "input exceeds maximum supported size of " << ::maniscalco::msufsort::max_input_size << " bytes";
+                std::cout << " (rebuild with -DMSUFSORT_64_BIT_SUFFIX_INDEX=ON for larger inputs)" << std::endl;
+                return 1;
+            }
         }
         else
         {
@@ -370,15 +445,15 @@ int32_t main
         }
 
         auto numWorkerThreads = 1;
-        if (argumentCount >= 4)
+        if (!arguments.empty())
         {
             try
             {
-                numWorkerThreads = std::stoi(inputArguments[3]);
+                numWorkerThreads = std::stoi(arguments[0]);
             }
             catch (...)
             {
-                std::cout << "INVALID THREAD COUNT: " << inputArguments[3] << std::endl;
+                std::cout << "INVALID THREAD COUNT: " << arguments[0] << std::endl;
                 throw std::exception();
             }
         }
@@ -402,7 +477,7 @@ int32_t main
                             auto input = make_input(numUniqueSymbols, inputSize);
                             auto suffixArray = ::maniscalco::make_suffix_array(input.begin(), input.end(), numWorkerThreads);
                              // validate
-                            errorCount = validate_suffix_array(input, suffixArray);
+                            errorCount = validate_suffix_array(input.data(), input.data() + input.size(), suffixArray.data());
                             if (errorCount)
                                 std::cout << "**** ERRORS DETECTED (" << errorCount << ") **** " << std::endl;
                         }
@@ -431,64 +506,112 @@ int32_t main
                         }
                     }
                 }
+                if (errorCount)
+                    exitCode = 1;
                 break;
             }
 
             case suffix_array:
             {
+                // the suffix array is computed directly into the mapped output file if there is one
                 std::cout << "computing suffix array" << std::endl;
-                auto suffixArray = ::maniscalco::make_suffix_array(input.begin(), input.end(), numWorkerThreads);
+                std::unique_ptr<mapped_file> output;
+                ::maniscalco::msufsort::suffix_array suffixArray;
+                suffix_index * suffixArrayBegin = nullptr;
+                if (!outputPath.empty())
+                {
+                    output.reset(new mapped_file(outputPath, mapped_file::output, (input->size() + 1) * sizeof(suffix_index)));
+                    suffixArrayBegin = (suffix_index *)output->begin();
+                }
+                else
+                {
+                    suffixArray.resize(input->size() + 1);
+                    suffixArrayBegin = suffixArray.data();
+                }
+                ::maniscalco::make_suffix_array(input->begin(), input->end(), suffixArrayBegin, numWorkerThreads);
                 auto finish = std::chrono::system_clock::now();
                 auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
                 std::cout << "suffix array completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
 
                 // validate 
-                std::cout << "validating suffix array" << std::endl;
-                auto errorCount = validate_suffix_array(input, suffixArray);
-                if (errorCount)
-                    std::cout << "**** ERRORS DETECTED (" << errorCount << ") **** " << std::endl;
-                else
-                    std::cout << "test completed and results validated successfully" << std::endl;
+                if (validate)
+                {
+                    std::cout << "validating suffix array" << std::endl;
+                    auto errorCount = validate_suffix_array(input->begin(), input->end(), suffixArrayBegin);
+                    if (errorCount)
+                    {
+                        std::cout << "**** ERRORS DETECTED (" << errorCount << ") **** " << std::endl;
+                        exitCode = 1;
+                    }
+                    else
+                        std::cout << "test completed and results validated successfully" << std::endl;
+                }
                 break;
             }
 
             case lcp_array:
             {
                 std::cout << "computing lcp array" << std::endl;
-                auto suffixArray = ::maniscalco::make_suffix_array(input.begin(), input.end(), numWorkerThreads);
+                auto suffixArray = ::maniscalco::make_suffix_array(input->begin(), input->end(), numWorkerThreads);
                 auto finish = std::chrono::system_clock::now();
                 auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
                 std::cout << "suffix array completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
-                make_lcp_array(suffixArray, input, numWorkerThreads);
+                if (!make_lcp_array(suffixArray, input->begin(), input->end(), numWorkerThreads, validate))
+                    exitCode = 1;
+                if ((!outputPath.empty()) && (!write_file(outputPath, suffixArray.begin(), suffixArray.end())))
+                {
+                    std::cout << "failed to write file: " << outputPath << std::endl;
+                    exitCode = 1;
+                }
                 break;
             }
 
             case burrows_wheeler_transform:
             {
-                auto copyOfInput = input;
+                // the transform is computed in place in the (copy on write) mapping of the input
                 std::cout << "computing burrows wheeler transform" << std::endl;
-                auto sentinelIndex = ::maniscalco::forward_burrows_wheeler_transform(input.begin(), input.end(), numWorkerThreads);
+                auto sentinelIndex = ::maniscalco::forward_burrows_wheeler_transform(input->begin(), input->end(), numWorkerThreads);
                 auto finish = std::chrono::system_clock::now();
                 auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
                 std::cout << "burrows wheeler transform completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
 
-                // validate
-                start = std::chrono::system_clock::now();
-                ::maniscalco::reverse_burrows_wheeler_transform(input.begin(), input.end(), sentinelIndex, numWorkerThreads);
-                finish = std::chrono::system_clock::now();
-                elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
-                std::cout << "inverse burrows wheeler transform completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
+                if (!outputPath.empty())
+                {
+                    std::ofstream outputStream(outputPath, std::ios_base::out | std::ios_base::binary);
+                    outputStream.write((char const *)&sentinelIndex, sizeof(sentinelIndex));
+                    outputStream.write((char const *)input->begin(), input->size());
+                    if (!outputStream)
+                    {
+                        std::cout << "failed to write file: " << outputPath << std::endl;
+                        exitCode = 1;
+                    }
+                }
 
-                if (input != copyOfInput)
-                    std::cout << "**** BWT ERROR DETECTED" << std::endl;
-                else
-                    std::cout << "test completed and results validated successfully" << std::endl;
+                // validate against the unmodified input file
+                if (validate)
+                {
+                    start = std::chrono::system_clock::now();
+                    ::maniscalco::reverse_burrows_wheeler_transform(input->begin(), input->end(), sentinelIndex, numWorkerThreads);
+                    finish = std::chrono::system_clock::now();
+                    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
+                    std::cout << "inverse burrows wheeler transform completed - total elapsed time: " << elapsed.count() << " ms" << std::endl;
+
+                    mapped_file originalInput(inputPath, mapped_file::input);
+                    if ((originalInput.size() != input->size()) || (std::memcmp(originalInput.begin(), input->begin(), input->size()) != 0))
+                    {
+                        std::cout << "**** BWT ERROR DETECTED" << std::endl;
+                        exitCode = 1;
+                    }
+                    else
+                        std::cout << "test completed and results validated successfully" << std::endl;
+                }
                 break;
             }
 
             default:
             {
                 print_usage();
+                exitCode = 1;
                 break;
             }
         }
@@ -496,8 +619,9 @@ int32_t main
     catch (...)
     {
         std::cout << "caught exception" << std::endl;
+        exitCode = 1;
     }
 
-    return 0;
+    return exitCode;
 }
 
@@ -33,27 +33,58 @@ SOFTWARE.
 #include <algorithm>
 #include <limits>
 #include <array>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <stdexcept>
+#include <exception>
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
 
 
 //==============================================================================
 maniscalco::msufsort::msufsort
 (
     int32_t numThreads
+):
+    msufsort(numThreads, {allocation_policy::standard_pages, allocation_policy::first_touch})
+{
+}
+
+
+//==============================================================================
+maniscalco::msufsort::msufsort
+(
+    int32_t numThreads,
+    allocation_policy allocationPolicy
 ):
     inputBegin_(nullptr),
     inputEnd_(nullptr),
     inputSize_(),
-    getValueEnd_(nullptr),
-    getValueMaxIndex_(),
     copyEnd_(),
     suffixArrayBegin_(nullptr),
     suffixArrayEnd_(nullptr),
     inverseSuffixArrayBegin_(nullptr),
     inverseSuffixArrayEnd_(nullptr),
     frontBucketOffset_(),
-    backBucketOffset_(new suffix_index *[0x10000]{}),
+    allocationPolicy_(allocationPolicy),
+    backBucketOffset_((suffix_index **)allocate_pages(0x10000 * sizeof(suffix_index *))),
     aCount_(),
     bCount_(),
+    anchors_(nullptr),
+    anchorIntervalMask_(),
+    anchorIntervalShift_(),
+    directSortBudget_(0),
+    unfinishedPartitionTasks_(0),
+    queuedPartitionTasks_(0),
+    idlePartitionThreads_(0),
+    partitionTaskMutex_(),
+    partitionTaskCondition_(),
     workerThreads_(new worker_thread[numThreads - 1]),
     numWorkerThreads_(numThreads - 1)
 {
@@ -65,6 +96,107 @@ maniscalco::msufsort::~msufsort
 (
 )
 {
+    release_pages(backBucketOffset_, 0x10000 * sizeof(suffix_index *));
+}
+
+
+//==============================================================================
+void * maniscalco::msufsort::allocate_pages
+(
+    // private:
+    // allocates zeroed memory for internal tables and workspace according to the allocation policy
+    std::size_t size
+) const
+{
+    #ifdef __linux__
+        auto mapSize = (((size + huge_page_size - 1) / huge_page_size) * huge_page_size);
+        if (allocationPolicy_.pageType_ == allocation_policy::explicit_huge_pages)
+        {
+            auto address = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (address != MAP_FAILED)
+            {
+                apply_allocation_policy(address, mapSize);
+                return address;
+            }
+        }
+        // map an extra huge page so that the region can be trimmed to huge page alignment
+        auto address = (std::uint8_t *)::mmap(nullptr, mapSize + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if ((void *)address == MAP_FAILED)
+            throw std::bad_alloc();
+        auto alignedAddress = (std::uint8_t *)((((std::uintptr_t)address) + huge_page_size - 1) & ~(huge_page_size - 1));
+        if (alignedAddress != address)
+            ::munmap(address, std::distance(address, alignedAddress));
+        ::munmap(alignedAddress + mapSize, huge_page_size - std::distance(address, alignedAddress));
+        apply_allocation_policy(alignedAddress, mapSize);
+        return alignedAddress;
+    #else
+        auto address = std::calloc(1, size);
+        if (address == nullptr)
+            throw std::bad_alloc();
+        return address;
+    #endif
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::release_pages
+(
+    // private:
+    // releases memory obtained via allocate_pages
+    void * address,
+    std::size_t size
+) const
+{
+    #ifdef __linux__
+        ::munmap(address, (((size + huge_page_size - 1) / huge_page_size) * huge_page_size));
+    #else
+        std::free(address);
+    #endif
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::apply_allocation_policy
+(
+    // private:
+    // advises the kernel of the huge page and NUMA placement for the pages
+    // of a region.  applied before the pages are first touched.
+    // failures are ignored and leave the default placement in effect.
+    void * address,
+    std::size_t size
+) const
+{
+    #ifdef __linux__
+        static std::size_t constexpr page_size = 0x1000;
+        auto begin = (((std::uintptr_t)address + page_size - 1) & ~(page_size - 1));
+        auto end = (((std::uintptr_t)address + size) & ~(page_size - 1));
+        if (end <= begin)
+            return;
+        if (allocationPolicy_.pageType_ != allocation_policy::standard_pages)
+            ::madvise((void *)begin, end - begin, MADV_HUGEPAGE);
+        // from linux/mempolicy.h.  invoked via syscall to avoid a dependency on libnuma
+        static int constexpr mpol_bind = 2;
+        static int constexpr mpol_interleave = 3;
+        static unsigned long constexpr mpol_f_mems_allowed = (1 << 2);
+        static unsigned long constexpr max_numa_nodes = 1024;
+        static unsigned long constexpr bits_per_mask_word = (8 * sizeof(unsigned long));
+        unsigned long nodeMask[max_numa_nodes / bits_per_mask_word] = {};
+        if (allocationPolicy_.numaPlacement_ == allocation_policy::interleave)
+        {
+            if (::syscall(SYS_get_mempolicy, nullptr, nodeMask, max_numa_nodes, nullptr, mpol_f_mems_allowed) == 0)
+                ::syscall(SYS_mbind, begin, end - begin, mpol_interleave, nodeMask, max_numa_nodes, 0);
+        }
+        else if (allocationPolicy_.numaPlacement_ == allocation_policy::bind)
+        {
+            unsigned int cpu = 0;
+            unsigned int node = 0;
+            if ((::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) && (node < max_numa_nodes))
+            {
+                nodeMask[node / bits_per_mask_word] = (1ul << (node % bits_per_mask_word));
+                ::syscall(SYS_mbind, begin, end - begin, mpol_bind, nodeMask, max_numa_nodes, 0);
+            }
+        }
+    #endif
 }
 
 
@@ -126,268 +258,684 @@ inline auto maniscalco::msufsort::get_suffix_type
 
 
 //==============================================================================
+template <typename key_type>
 inline auto maniscalco::msufsort::get_value
 (
     uint8_t const * inputCurrent,
     suffix_index index
-) const -> suffix_value
+) const -> key_type
 {
     inputCurrent += (index & sa_index_mask);
-    if (inputCurrent >= getValueEnd_)
+    if (inputCurrent >= (inputEnd_ - sizeof(key_type)))
     {
         if (inputCurrent >= inputEnd_)
             return 0;
-        inputCurrent = (copyEnd_ + (sizeof(suffix_value) - std::distance(inputCurrent, inputEnd_)));
+        inputCurrent = (copyEnd_ + (sizeof(max_suffix_value) - std::distance(inputCurrent, inputEnd_)));
     }
-    return endian_swap<host_order_type, big_endian_type>(*(suffix_value const *)(inputCurrent));
+    return endian_swap<host_order_type, big_endian_type>(*(key_type const *)(inputCurrent));
 }
 
 
 //==============================================================================
-inline bool maniscalco::msufsort::compare_suffixes
+inline void maniscalco::msufsort::prefetch_value
 (
-    // optimized compare_suffixes for when two suffixes have long common match lengths
-    std::uint8_t const * inputBegin,
-    suffix_index indexA,
-    suffix_index indexB
+    // private:
+    // hint that the key at the given suffix will soon be read by get_value
+    uint8_t const * inputCurrent,
+    suffix_index index
 ) const
 {
-    indexA &= sa_index_mask;
-    indexB &= sa_index_mask;
+    #ifdef __GNUC__
+        __builtin_prefetch(inputCurrent + (index & sa_index_mask));
+    #endif
+}
 
-    if (indexA > indexB)
-        return !compare_suffixes(inputBegin, indexB, indexA);
 
-    auto inputCurrentA = inputBegin + indexA;
-    auto inputCurrentB = inputBegin + indexB;
-    while ((inputCurrentB <= getValueEnd_) && (*(suffix_value const *)inputCurrentB == *(suffix_value const *)inputCurrentA))
-    {
-        inputCurrentB += sizeof(suffix_value);
-        inputCurrentA += sizeof(suffix_value);
-    }
-    if (inputCurrentB >= getValueEnd_)
+//==============================================================================
+template <typename key_type>
+inline void maniscalco::msufsort::post_partition_task
+(
+    // private:
+    // shares a partition task via the posting thread's deque and wakes an idle thread to take it
+    partition_task_deque<key_type> & partitionTaskDeque,
+    partition_task<key_type> const & partitionTask
+)
+{
+    ++unfinishedPartitionTasks_;
+    partitionTaskDeque.push(partitionTask);
+    ++queuedPartitionTasks_;
+    if (idlePartitionThreads_.load() > 0)
     {
-        if (inputCurrentB >= inputEnd_)
-            return true;
-        inputCurrentB = (copyEnd_ + (sizeof(suffix_value) - std::distance(inputCurrentB, inputEnd_)));
+        {
+            std::lock_guard<std::mutex> lock(partitionTaskMutex_);
+        }
+        partitionTaskCondition_.notify_one();
     }
-    auto valueB = endian_swap<host_order_type, big_endian_type>(*(suffix_value const *)(inputCurrentB));
+}
 
-    if (inputCurrentA >= getValueEnd_)
-        inputCurrentA = (copyEnd_ + (sizeof(suffix_value) - std::distance(inputCurrentA, inputEnd_)));
-    auto valueA = endian_swap<host_order_type, big_endian_type>(*(suffix_value const *)(inputCurrentA));
-    return (valueA >= valueB);
+
+//==============================================================================
+inline bool maniscalco::msufsort::direct_sort_abandoned
+(
+    // private:
+    // returns true once the direct sort budget is exhausted
+) const
+{
+    return (directSortBudget_.load(std::memory_order_relaxed) < 0);
 }
 
 
 //==============================================================================
-inline int maniscalco::msufsort::compare_suffixes
+inline bool maniscalco::msufsort::charge_direct_sort_budget
 (
-    // optimized compare_suffixes for when two suffixes have long common match lengths
-    std::uint8_t const * inputBegin,
-    suffix_index indexA,
-    suffix_index indexB,
-    std::size_t maxLength
+    // private:
+    // charge work done on deep partitions against the direct sort budget.
+    // returns false if the budget is exhausted and the direct sort should be abandoned.
+    std::int64_t work
 ) const
 {
-    indexA &= sa_index_mask;
-    indexB &= sa_index_mask;
+    return ((directSortBudget_.fetch_sub(work, std::memory_order_relaxed) - work) >= 0);
+}
 
-    if (indexA > indexB)
-        return -compare_suffixes(inputBegin, indexB, indexA);
 
-    auto inputCurrentA = inputBegin + indexA;
-    auto inputCurrentB = inputBegin + indexB;
-    while ((maxLength >= 4) && (inputCurrentB <= getValueEnd_) && (*(suffix_value const *)inputCurrentB == *(suffix_value const *)inputCurrentA))
+//==============================================================================
+std::size_t maniscalco::msufsort::match_length_scalar
+(
+    // private:
+    // returns the number of leading bytes (up to maxLength) which are equal 
+    // for both inputs.  compares eight bytes per step.
+    std::uint8_t const * inputA,
+    std::uint8_t const * inputB,
+    std::size_t maxLength
+)
+{
+    std::size_t matchLength = 0;
+    while ((matchLength + sizeof(std::uint64_t)) <= maxLength)
     {
-        inputCurrentB += sizeof(suffix_value);
-        inputCurrentA += sizeof(suffix_value);
-        maxLength -= 4;
+        std::uint64_t valueA;
+        std::uint64_t valueB;
+        std::memcpy(&valueA, inputA + matchLength, sizeof(valueA));
+        std::memcpy(&valueB, inputB + matchLength, sizeof(valueB));
+        if (valueA != valueB)
+        {
+            #if defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+                return (matchLength + (__builtin_ctzll(valueA ^ valueB) >> 3));
+            #else
+                break;
+            #endif
+        }
+        matchLength += sizeof(std::uint64_t);
     }
-    if (inputCurrentB >= getValueEnd_)
+    while ((matchLength < maxLength) && (inputA[matchLength] == inputB[matchLength]))
+        ++matchLength;
+    return matchLength;
+}
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+//==============================================================================
+__attribute__((target("sse2"))) std::size_t maniscalco::msufsort::match_length_sse2
+(
+    // private:
+    // as match_length_scalar but compares sixteen bytes per step
+    std::uint8_t const * inputA,
+    std::uint8_t const * inputB,
+    std::size_t maxLength
+)
+{
+    std::size_t matchLength = 0;
+    while ((matchLength + sizeof(__m128i)) <= maxLength)
     {
-        if (inputCurrentB >= inputEnd_)
-            return -1;
-        inputCurrentB = (copyEnd_ + (sizeof(suffix_value) - std::distance(inputCurrentB, inputEnd_)));
+        auto valueA = _mm_loadu_si128((__m128i const *)(inputA + matchLength));
+        auto valueB = _mm_loadu_si128((__m128i const *)(inputB + matchLength));
+        auto mismatch = (~(std::uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(valueA, valueB)) & 0xffff);
+        if (mismatch)
+            return (matchLength + __builtin_ctz(mismatch));
+        matchLength += sizeof(__m128i);
     }
-    auto valueB = endian_swap<host_order_type, big_endian_type>(*(suffix_value const *)(inputCurrentB));
-
-    if (inputCurrentA >= getValueEnd_)
-        inputCurrentA = (copyEnd_ + (sizeof(suffix_value) - std::distance(inputCurrentA, inputEnd_)));
-    auto valueA = endian_swap<host_order_type, big_endian_type>(*(suffix_value const *)(inputCurrentA));
-    return (valueB - valueA);
+    return (matchLength + match_length_scalar(inputA + matchLength, inputB + matchLength, maxLength - matchLength));
 }
 
 
 //==============================================================================
-void maniscalco::msufsort::multikey_insertion_sort
+__attribute__((target("avx2"))) std::size_t maniscalco::msufsort::match_length_avx2
 (
     // private:
-    // sorts the suffixes by insertion sort
-    suffix_index * partitionBegin,
-    suffix_index * partitionEnd,
-    std::int32_t currentMatchLength,
-    suffix_value startingPattern,
-    std::array<suffix_value, 2> endingPattern,
-    std::vector<tandem_repeat_info> & tandemRepeatStack
+    // as match_length_scalar but compares thirty two bytes per step
+    std::uint8_t const * inputA,
+    std::uint8_t const * inputB,
+    std::size_t maxLength
 )
 {
-    std::int32_t partitionSize = (std::int32_t)std::distance(partitionBegin, partitionEnd);
-    if (partitionSize < 2)
-        return;
-    struct partition_info
+    std::size_t matchLength = 0;
+    while ((matchLength + sizeof(__m256i)) <= maxLength)
     {
-        std::int32_t currentMatchLength_;
-        std::int32_t size_;
-        suffix_value startingPattern_;
-        suffix_value endingPattern_;
-        bool hasPotentialTandemRepeats_;
-    };
-    partition_info stack[insertion_sort_threshold];
-    stack[0] = {currentMatchLength, partitionSize, startingPattern, endingPattern[0], false};
-    auto stackTop = stack + 1;
+        auto valueA = _mm256_loadu_si256((__m256i const *)(inputA + matchLength));
+        auto valueB = _mm256_loadu_si256((__m256i const *)(inputB + matchLength));
+        auto mismatch = ~(std::uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(valueA, valueB));
+        if (mismatch)
+            return (matchLength + __builtin_ctz(mismatch));
+        matchLength += sizeof(__m256i);
+    }
+    return (matchLength + match_length_sse2(inputA + matchLength, inputB + matchLength, maxLength - matchLength));
+}
 
-    while (stackTop-- != stack)
-    {
-        auto currentMatchLength = stackTop->currentMatchLength_;
-        auto size = stackTop->size_;
-        endingPattern[0] = stackTop->endingPattern_;
-        auto hasPotentialTandemRepeats = stackTop->hasPotentialTandemRepeats_;
-        startingPattern = stackTop->startingPattern_;
+#endif
 
-        if (size <= 2)
+
+//==============================================================================
+auto maniscalco::msufsort::select_match_length_function
+(
+    // private:
+    // selects the widest match length kernel supported by the host cpu
+) -> match_length_function
+{
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &match_length_avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return &match_length_sse2;
+    #endif
+    return &match_length_scalar;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::store_symbols_scalar
+(
+    // private:
+    // stores the low byte of each of the suffix array entries provided.  used to 
+    // write the burrows wheeler transform from the suffix array to the output.
+    suffix_index const * begin,
+    suffix_index const * end,
+    std::uint8_t * output
+)
+{
+    while (begin < end)
+        *output++ = (std::uint8_t)*begin++;
+}
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+//==============================================================================
+__attribute__((target("sse2"))) void maniscalco::msufsort::store_symbols_sse2
+(
+    // private:
+    // as store_symbols_scalar but packs sixteen entries per step and writes them with 
+    // non temporal (streaming) stores so that the output does not evict the suffix array 
+    // from the cache.
+    suffix_index const * begin,
+    suffix_index const * end,
+    std::uint8_t * output
+)
+{
+    while ((begin < end) && (((std::uintptr_t)output & (sizeof(__m128i) - 1)) != 0))
+        *output++ = (std::uint8_t)*begin++;
+    auto const lowByteMask = _mm_set1_epi32(0xff);
+    while ((begin + sizeof(__m128i)) <= end)
+    {
+        __m128i value[4];
+        if constexpr (sizeof(suffix_index) == sizeof(std::int32_t))
         {
-            if ((size == 2) && (compare_suffixes(inputBegin_ + currentMatchLength, partitionBegin[0], partitionBegin[1])))
-                std::swap(partitionBegin[0], partitionBegin[1]);
-            partitionBegin += size;
+            for (auto i = 0; i < 4; ++i)
+                value[i] = _mm_and_si128(_mm_loadu_si128((__m128i const *)begin + i), lowByteMask);
         }
         else
         {
-            if (currentMatchLength >= min_match_length_for_tandem_repeats)
-            {
-                if (hasPotentialTandemRepeats)
-                {
-                    auto tandemRepeatCount = partition_tandem_repeats(partitionBegin, partitionBegin + size, currentMatchLength, tandemRepeatStack);
-                    size -= tandemRepeatCount;
-                    partitionBegin += tandemRepeatCount;
-                    if (size == 0)
-                        continue;
-                }
-            }
-
-            suffix_value value[insertion_sort_threshold];
-            value[0] = get_value(inputBegin_ + currentMatchLength, partitionBegin[0]);
-            for (std::int32_t i = 1; i < size; ++i)
-            {
-                auto currentIndex = partitionBegin[i];
-                suffix_value currentValue = get_value(inputBegin_ + currentMatchLength, partitionBegin[i]);
-                auto j = i;
-                while ((j > 0) && (value[j - 1] > currentValue))
-                {
-                    value[j] = value[j - 1];
-                    partitionBegin[j] = partitionBegin[j - 1];
-                    --j;
-                }
-                value[j] = currentValue;
-                partitionBegin[j] = currentIndex;
-            }
-
-            auto i = (std::int32_t)size - 1;
-            auto nextMatchLength = currentMatchLength + (std::int32_t)sizeof(suffix_value);
-            while (i >= 0)
+            // keep the low half of each of the 64 bit entries
+            for (auto i = 0; i < 4; ++i)
             {
-                std::int32_t start = i--;
-                auto startValue = value[start];
-                while ((i >= 0) && (value[i] == startValue))
-                    --i;
-                auto partitionSize = (start - i);
-                auto potentialTandemRepeats = has_potential_tandem_repeats(startingPattern, {endingPattern[0], startValue});
-                if (nextMatchLength == (2 + sizeof(suffix_value)))
-                    startingPattern = get_value(inputBegin_, *partitionBegin);
-                *stackTop++ = partition_info{nextMatchLength, partitionSize, startingPattern, startValue, potentialTandemRepeats};
+                auto low = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)begin + (i << 1)), _MM_SHUFFLE(3, 1, 2, 0));
+                auto high = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)begin + (i << 1) + 1), _MM_SHUFFLE(3, 1, 2, 0));
+                value[i] = _mm_and_si128(_mm_unpacklo_epi64(low, high), lowByteMask);
             }
-
         }
+        auto symbols = _mm_packus_epi16(_mm_packs_epi32(value[0], value[1]), _mm_packs_epi32(value[2], value[3]));
+        _mm_stream_si128((__m128i *)output, symbols);
+        begin += sizeof(__m128i);
+        output += sizeof(__m128i);
     }
+    _mm_sfence();
+    store_symbols_scalar(begin, end, output);
 }
 
+#endif
+
 
 //==============================================================================
-inline bool maniscalco::msufsort::has_potential_tandem_repeats
+auto maniscalco::msufsort::select_store_symbols_function
 (
-    suffix_value startingPattern,
-    std::array<suffix_value, 2> endingPattern
-) const
+    // private:
+    // selects the widest store symbols kernel supported by the host cpu
+) -> store_symbols_function
 {
-    if (!tandemRepeatSortEnabled_)
-       return false;
-    std::int8_t const * end = (std::int8_t const *)endingPattern.data();
-    std::int8_t const * begin = end + sizeof(suffix_value);
-    while (begin > end)
-        if (*(suffix_value const *)--begin == *(suffix_value *)&startingPattern)
-            return true;
-    return false;
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2"))
+            return &store_symbols_sse2;
+    #endif
+    return &store_symbols_scalar;
 }
 
 
 //==============================================================================
-std::size_t maniscalco::msufsort::partition_tandem_repeats
+inline void maniscalco::msufsort::store_symbols
 (
     // private:
-    // the tandem repeat sort.  determines if the suffixes provided are tandem repeats
-    // of other suffixes from within the same group.  If so, sorts the non tandem
-    // repeat suffixes and then induces the sorted order of the suffixes which are
-    // tandem repeats.
-    suffix_index * partitionBegin,
-    suffix_index * partitionEnd,
-    std::int32_t currentMatchLength,
-    std::vector<tandem_repeat_info> & tandemRepeatStack
+    // stores the low byte of each of the suffix array entries provided using the 
+    // kernel selected for the host cpu
+    suffix_index const * begin,
+    suffix_index const * end,
+    std::uint8_t * output
 )
 {
-    auto parititionSize = std::distance(partitionBegin, partitionEnd);
-    std::sort(partitionBegin, partitionEnd, [](suffix_index a, suffix_index b) -> bool{return ((a & sa_index_mask) < (b & sa_index_mask));});
-    std::int32_t tandemRepeatLength = 0;
-    auto const halfCurrentMatchLength = (currentMatchLength >> 1);
+    static store_symbols_function const storeSymbolsFunction = select_store_symbols_function();
+    storeSymbolsFunction(begin, end, output);
+}
 
-    // determine if there are tandem repeats and, if so, what the tandem repeat length is.
-    auto previousSuffixIndex = (partitionBegin[0] & sa_index_mask);
-    for (auto cur = partitionBegin + 1; ((tandemRepeatLength == 0) && (cur < partitionEnd)); ++cur)
+
+//==============================================================================
+void maniscalco::msufsort::pack_suffix_indexes
+(
+    // private:
+    // packs each suffix index into packed_suffix_index_size little endian bytes.  writes exactly
+    // ((end - begin) * packed_suffix_index_size) bytes so that ranges can be packed in parallel.
+    suffix_index const * begin,
+    suffix_index const * end,
+    std::uint8_t * output
+)
+{
+    while ((begin + 1) < end)
     {
-        auto currentSuffixIndex = (*cur & sa_index_mask);
-        if ((previousSuffixIndex + halfCurrentMatchLength) >= currentSuffixIndex)
-            tandemRepeatLength = (currentSuffixIndex - previousSuffixIndex);
-        previousSuffixIndex = currentSuffixIndex;
+        // the three high bytes of each eight byte store are overwritten by the next index
+        auto value = endian_swap<host_order_type, little_endian_type>((std::uint64_t)*begin++);
+        std::memcpy(output, &value, sizeof(value));
+        output += packed_suffix_index_size;
     }
-    if (tandemRepeatLength == 0)
-        return 0; // no tandem repeats were found
-    // tandem repeats detected.
-    suffix_index * terminatorsEnd = partitionEnd - 1;
-    previousSuffixIndex = (partitionEnd[-1] & sa_index_mask);
-    for (auto cur = partitionEnd - 2; cur >= partitionBegin; --cur)
+    if (begin < end)
     {
-	    auto currentSuffixIndex = (*cur & sa_index_mask);
-	    if ((previousSuffixIndex - currentSuffixIndex) == tandemRepeatLength)
-            std::swap(*terminatorsEnd--, *cur);// suffix is a tandem repeat
-	    previousSuffixIndex = currentSuffixIndex;
+        auto value = endian_swap<host_order_type, little_endian_type>((std::uint64_t)*begin);
+        std::memcpy(output, &value, packed_suffix_index_size);
     }
-    auto numTerminators = (std::distance(partitionBegin, terminatorsEnd) + 1);
-    std::reverse(partitionBegin, partitionEnd);
-    tandemRepeatStack.push_back(tandem_repeat_info(partitionBegin, partitionEnd, (std::int32_t)numTerminators, tandemRepeatLength));
-    return (parititionSize - numTerminators);
 }
 
 
-//======================================================================================================================
-void maniscalco::msufsort::complete_tandem_repeats
+//==============================================================================
+void maniscalco::msufsort::unpack_suffix_indexes_scalar
 (
-    std::vector<tandem_repeat_info> & tandemRepeatStack
+    // private:
+    // unpacks each packed suffix index with one eight byte load where the load remains 
+    // within the packed input
+    std::uint8_t const * input,
+    std::size_t count,
+    suffix_index * output
 )
 {
-    while (!tandemRepeatStack.empty())
+    static std::uint64_t constexpr packed_mask = ((1ull << (packed_suffix_index_size * 8)) - 1);
+    auto end = output + count;
+    while ((output + 1) < end)
     {
-        tandem_repeat_info tandemRepeat = tandemRepeatStack.back();
-        tandemRepeatStack.pop_back();
-        complete_tandem_repeat(tandemRepeat.partitionBegin_, tandemRepeat.partitionEnd_, tandemRepeat.numTerminators_, tandemRepeat.tandemRepeatLength_);
+        std::uint64_t value;
+        std::memcpy(&value, input, sizeof(value));
+        *output++ = (suffix_index)(endian_swap<little_endian_type, host_order_type>(value) & packed_mask);
+        input += packed_suffix_index_size;
+    }
+    if (output < end)
+    {
+        std::uint64_t value = 0;
+        std::memcpy(&value, input, packed_suffix_index_size);
+        *output = (suffix_index)endian_swap<little_endian_type, host_order_type>(value);
+    }
+}
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+//==============================================================================
+__attribute__((target("ssse3"))) void maniscalco::msufsort::unpack_suffix_indexes_ssse3
+(
+    // private:
+    // as unpack_suffix_indexes_scalar but unpacks two 64 bit suffix indexes per step with
+    // one sixteen byte load and one byte shuffle.
+    std::uint8_t const * input,
+    std::size_t count,
+    suffix_index * output
+)
+{
+    if constexpr (sizeof(suffix_index) == sizeof(std::int64_t))
+    {
+        auto const shuffle = _mm_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1);
+        // the sixteen byte load spans (a little more than) three packed indexes
+        while (count >= 4)
+        {
+            auto value = _mm_loadu_si128((__m128i const *)input);
+            _mm_storeu_si128((__m128i *)output, _mm_shuffle_epi8(value, shuffle));
+            input += (2 * packed_suffix_index_size);
+            output += 2;
+            count -= 2;
+        }
+    }
+    unpack_suffix_indexes_scalar(input, count, output);
+}
+
+
+//==============================================================================
+__attribute__((target("avx2"))) void maniscalco::msufsort::unpack_suffix_indexes_avx2
+(
+    // private:
+    // as unpack_suffix_indexes_ssse3 but unpacks four 64 bit suffix indexes per step.
+    // each 128 bit lane is loaded separately and shuffled as above.
+    std::uint8_t const * input,
+    std::size_t count,
+    suffix_index * output
+)
+{
+    if constexpr (sizeof(suffix_index) == sizeof(std::int64_t))
+    {
+        auto const shuffle = _mm256_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1,
+                0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1);
+        // the second lane's sixteen byte load ends (a little more than) six packed indexes on
+        while (count >= 6)
+        {
+            auto value = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const *)input)), 
+                    _mm_loadu_si128((__m128i const *)(input + (2 * packed_suffix_index_size))), 1);
+            _mm256_storeu_si256((__m256i *)output, _mm256_shuffle_epi8(value, shuffle));
+            input += (4 * packed_suffix_index_size);
+            output += 4;
+            count -= 4;
+        }
+    }
+    unpack_suffix_indexes_ssse3(input, count, output);
+}
+
+#endif
+
+
+//==============================================================================
+auto maniscalco::msufsort::select_unpack_suffix_indexes_function
+(
+    // private:
+    // selects the widest unpack kernel supported by the host cpu
+) -> unpack_suffix_indexes_function
+{
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &unpack_suffix_indexes_avx2;
+        if (__builtin_cpu_supports("ssse3"))
+            return &unpack_suffix_indexes_ssse3;
+    #endif
+    return &unpack_suffix_indexes_scalar;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::unpack_suffix_indexes
+(
+    // public:
+    // unpacks 'count' packed suffix indexes using the kernel selected for the host cpu
+    std::uint8_t const * input,
+    std::size_t count,
+    suffix_index * output
+)
+{
+    static unpack_suffix_indexes_function const unpackSuffixIndexesFunction = select_unpack_suffix_indexes_function();
+    unpackSuffixIndexesFunction(input, count, output);
+}
+
+
+//==============================================================================
+inline std::size_t maniscalco::msufsort::match_length
+(
+    // private:
+    // returns the number of leading bytes (up to maxLength) which are equal 
+    // for both inputs using the kernel selected for the host cpu
+    std::uint8_t const * inputA,
+    std::uint8_t const * inputB,
+    std::size_t maxLength
+)
+{
+    static match_length_function const matchLengthFunction = select_match_length_function();
+    return matchLengthFunction(inputA, inputB, maxLength);
+}
+
+
+//==============================================================================
+inline bool maniscalco::msufsort::compare_suffixes
+(
+    // optimized compare_suffixes for when two suffixes have long common match lengths.
+    // returns true if suffix A is greater than suffix B.
+    std::uint8_t const * inputBegin,
+    suffix_index indexA,
+    suffix_index indexB
+) const
+{
+    indexA &= sa_index_mask;
+    indexB &= sa_index_mask;
+
+    if (indexA > indexB)
+        return !compare_suffixes(inputBegin, indexB, indexA);
+
+    // suffix B is the shorter of the two.  scan no further than its end.
+    auto inputCurrentA = inputBegin + indexA;
+    auto inputCurrentB = inputBegin + indexB;
+    if (inputCurrentB >= inputEnd_)
+        return true;
+    auto matchLength = match_length(inputCurrentA, inputCurrentB, std::distance(inputCurrentB, inputEnd_));
+    if (matchLength >= direct_sort_budget_min_match_length)
+        charge_direct_sort_budget(matchLength / sizeof(std::uint32_t));
+    if ((inputCurrentB + matchLength) >= inputEnd_)
+        return true; // suffix B is a prefix of suffix A
+    return (inputCurrentA[matchLength] > inputCurrentB[matchLength]);
+}
+
+
+//==============================================================================
+inline int maniscalco::msufsort::compare_suffixes
+(
+    // optimized compare_suffixes for when two suffixes have long common match lengths.
+    // compares at most maxLength bytes.  returns a positive value if suffix A is less
+    // than suffix B, a negative value if greater and zero if equal over maxLength bytes.
+    std::uint8_t const * inputBegin,
+    suffix_index indexA,
+    suffix_index indexB,
+    std::size_t maxLength
+) const
+{
+    indexA &= sa_index_mask;
+    indexB &= sa_index_mask;
+
+    if (indexA > indexB)
+        return -compare_suffixes(inputBegin, indexB, indexA, maxLength);
+
+    auto inputCurrentA = inputBegin + indexA;
+    auto inputCurrentB = inputBegin + indexB;
+    std::size_t remainingB = std::distance(inputCurrentB, inputEnd_);
+    auto matchLength = match_length(inputCurrentA, inputCurrentB, std::min(maxLength, remainingB));
+    if (matchLength == maxLength)
+        return 0;
+    if (matchLength == remainingB)
+        return -1;
+    return ((int)inputCurrentB[matchLength] - (int)inputCurrentA[matchLength]);
+}
+
+
+//==============================================================================
+template <typename key_type>
+void maniscalco::msufsort::multikey_insertion_sort
+(
+    // private:
+    // sorts the suffixes by insertion sort
+    suffix_index * partitionBegin,
+    suffix_index * partitionEnd,
+    suffix_index currentMatchLength,
+    key_type startingPattern,
+    std::array<key_type, 2> endingPattern,
+    std::vector<tandem_repeat_info> & tandemRepeatStack
+)
+{
+    std::int32_t partitionSize = (std::int32_t)std::distance(partitionBegin, partitionEnd);
+    if (partitionSize < 2)
+        return;
+    struct partition_info
+    {
+        suffix_index currentMatchLength_;
+        std::int32_t size_;
+        key_type startingPattern_;
+        key_type endingPattern_;
+        bool hasPotentialTandemRepeats_;
+    };
+    partition_info stack[insertion_sort_threshold];
+    stack[0] = {currentMatchLength, partitionSize, startingPattern, endingPattern[0], false};
+    auto stackTop = stack + 1;
+
+    while (stackTop-- != stack)
+    {
+        auto currentMatchLength = stackTop->currentMatchLength_;
+        auto size = stackTop->size_;
+        endingPattern[0] = stackTop->endingPattern_;
+        auto hasPotentialTandemRepeats = stackTop->hasPotentialTandemRepeats_;
+        startingPattern = stackTop->startingPattern_;
+        if ((currentMatchLength >= direct_sort_budget_min_match_length) && (!charge_direct_sort_budget(size)))
+            return;
+
+        if (size <= 2)
+        {
+            if ((size == 2) && (compare_suffixes(inputBegin_ + currentMatchLength, partitionBegin[0], partitionBegin[1])))
+                std::swap(partitionBegin[0], partitionBegin[1]);
+            partitionBegin += size;
+        }
+        else
+        {
+            if (currentMatchLength >= min_match_length_for_tandem_repeats<key_type>)
+            {
+                if (hasPotentialTandemRepeats)
+                {
+                    auto tandemRepeatCount = partition_tandem_repeats(partitionBegin, partitionBegin + size, currentMatchLength, tandemRepeatStack);
+                    size -= tandemRepeatCount;
+                    partitionBegin += tandemRepeatCount;
+                    if (size == 0)
+                        continue;
+                }
+            }
+
+            key_type value[insertion_sort_threshold];
+            value[0] = get_value<key_type>(inputBegin_ + currentMatchLength, partitionBegin[0]);
+            for (std::int32_t i = 1; i < size; ++i)
+            {
+                auto currentIndex = partitionBegin[i];
+                key_type currentValue = get_value<key_type>(inputBegin_ + currentMatchLength, partitionBegin[i]);
+                auto j = i;
+                while ((j > 0) && (value[j - 1] > currentValue))
+                {
+                    value[j] = value[j - 1];
+                    partitionBegin[j] = partitionBegin[j - 1];
+                    --j;
+                }
+                value[j] = currentValue;
+                partitionBegin[j] = currentIndex;
+            }
+
+            auto i = (std::int32_t)size - 1;
+            auto nextMatchLength = currentMatchLength + (suffix_index)sizeof(key_type);
+            while (i >= 0)
+            {
+                std::int32_t start = i--;
+                auto startValue = value[start];
+                while ((i >= 0) && (value[i] == startValue))
+                    --i;
+                auto partitionSize = (start - i);
+                auto potentialTandemRepeats = has_potential_tandem_repeats<key_type>(startingPattern, {endingPattern[0], startValue});
+                if ((currentMatchLength < (suffix_index)(2 + sizeof(key_type))) && (nextMatchLength >= (suffix_index)(2 + sizeof(key_type))))
+                    startingPattern = get_value<key_type>(inputBegin_, *partitionBegin);
+                *stackTop++ = partition_info{nextMatchLength, partitionSize, startingPattern, startValue, potentialTandemRepeats};
+            }
+
+        }
+    }
+}
+
+
+//==============================================================================
+template <typename key_type>
+inline bool maniscalco::msufsort::has_potential_tandem_repeats
+(
+    key_type startingPattern,
+    std::array<key_type, 2> endingPattern
+) const
+{
+    if (!tandemRepeatSortEnabled_)
+       return false;
+    std::int8_t const * end = (std::int8_t const *)endingPattern.data();
+    std::int8_t const * begin = end + sizeof(key_type);
+    while (begin > end)
+        if (*(key_type const *)--begin == *(key_type *)&startingPattern)
+            return true;
+    return false;
+}
+
+
+//==============================================================================
+std::size_t maniscalco::msufsort::partition_tandem_repeats
+(
+    // private:
+    // the tandem repeat sort.  determines if the suffixes provided are tandem repeats
+    // of other suffixes from within the same group.  If so, sorts the non tandem
+    // repeat suffixes and then induces the sorted order of the suffixes which are
+    // tandem repeats.
+    suffix_index * partitionBegin,
+    suffix_index * partitionEnd,
+    suffix_index currentMatchLength,
+    std::vector<tandem_repeat_info> & tandemRepeatStack
+)
+{
+    auto parititionSize = std::distance(partitionBegin, partitionEnd);
+    std::sort(partitionBegin, partitionEnd, [](suffix_index a, suffix_index b) -> bool{return ((a & sa_index_mask) < (b & sa_index_mask));});
+    suffix_index tandemRepeatLength = 0;
+    auto const halfCurrentMatchLength = (currentMatchLength >> 1);
+
+    // determine if there are tandem repeats and, if so, what the tandem repeat length is.
+    auto previousSuffixIndex = (partitionBegin[0] & sa_index_mask);
+    for (auto cur = partitionBegin + 1; ((tandemRepeatLength == 0) && (cur < partitionEnd)); ++cur)
+    {
+        auto currentSuffixIndex = (*cur & sa_index_mask);
+        if ((previousSuffixIndex + halfCurrentMatchLength) >= currentSuffixIndex)
+            tandemRepeatLength = (currentSuffixIndex - previousSuffixIndex);
+        previousSuffixIndex = currentSuffixIndex;
+    }
+    if (tandemRepeatLength == 0)
+        return 0; // no tandem repeats were found
+    // tandem repeats detected.
+    suffix_index * terminatorsEnd = partitionEnd - 1;
+    previousSuffixIndex = (partitionEnd[-1] & sa_index_mask);
+    for (auto cur = partitionEnd - 2; cur >= partitionBegin; --cur)
+    {
+	    auto currentSuffixIndex = (*cur & sa_index_mask);
+	    if ((previousSuffixIndex - currentSuffixIndex) == tandemRepeatLength)
+            std::swap(*terminatorsEnd--, *cur);// suffix is a tandem repeat
+	    previousSuffixIndex = currentSuffixIndex;
+    }
+    auto numTerminators = (std::distance(partitionBegin, terminatorsEnd) + 1);
+    std::reverse(partitionBegin, partitionEnd);
+    tandemRepeatStack.push_back(tandem_repeat_info(partitionBegin, partitionEnd, (suffix_index)numTerminators, tandemRepeatLength));
+    return (parititionSize - numTerminators);
+}
+
+
+//======================================================================================================================
+void maniscalco::msufsort::complete_tandem_repeats
+(
+    std::vector<tandem_repeat_info> & tandemRepeatStack
+)
+{
+    while (!tandemRepeatStack.empty())
+    {
+        tandem_repeat_info tandemRepeat = tandemRepeatStack.back();
+        tandemRepeatStack.pop_back();
+        complete_tandem_repeat(tandemRepeat.partitionBegin_, tandemRepeat.partitionEnd_, tandemRepeat.numTerminators_, tandemRepeat.tandemRepeatLength_);
     }
 }
 
@@ -397,8 +945,8 @@ inline void maniscalco::msufsort::complete_tandem_repeat
 (
     suffix_index * partitionBegin,
     suffix_index * partitionEnd,
-    std::int32_t numTerminators,
-    std::int32_t tandemRepeatLength
+    suffix_index numTerminators,
+    suffix_index tandemRepeatLength
 )
 {
     suffix_index * terminatorsBegin = partitionEnd - numTerminators;
@@ -410,10 +958,10 @@ inline void maniscalco::msufsort::complete_tandem_repeat
     // now use sorted order of terminators to determine sorted order of repeats.
     // figure out how many terminators sort before the repeat and how
     // many sort after the repeat.  put them on left and right extremes of the array.
-    std::int32_t m = 0;
-    std::int32_t a = 0;
-    std::int32_t b = numTerminators - 1;
-    std::int32_t numTypeA = 0;
+    suffix_index m = 0;
+    suffix_index a = 0;
+    suffix_index b = numTerminators - 1;
+    suffix_index numTypeA = 0;
     while (a <= b)
     {
         m = (a + b) >> 1;
@@ -430,9 +978,9 @@ inline void maniscalco::msufsort::complete_tandem_repeat
     }
     if (numTypeA > numTerminators)
         numTypeA = numTerminators;
-    std::int32_t numTypeB = (numTerminators - numTypeA);
+    suffix_index numTypeB = (numTerminators - numTypeA);
 
-    for (std::int32_t i = 0; i < numTypeA; ++i)
+    for (suffix_index i = 0; i < numTypeA; ++i)
         partitionBegin[i] = terminatorsBegin[i];
 
     // type A repeats
@@ -485,50 +1033,31 @@ inline void maniscalco::msufsort::complete_tandem_repeat
 
 
 //==============================================================================
-auto maniscalco::msufsort::multikey_quicksort
+template <typename key_type, typename element_type, typename get_key_function, typename prefetch_function>
+inline auto maniscalco::msufsort::partition_seven_ways
 (
     // private:
-    // multi key quicksort on the input data provided
-    suffix_index * suffixArrayBegin,
-    suffix_index * suffixArrayEnd,
-    std::int32_t currentMatchLength,
-    suffix_value startingPattern,
-    std::array<suffix_value, 2> endingPattern,
-    std::vector<tandem_repeat_info> & tandemRepeatStack
-) -> suffix_index *
+    // selects three pivots and partitions the elements seven ways about them (less than, equal 
+    // to each pivot and between the pivots).  the elements are either suffix indexes or cached keys.
+    // returns the six boundaries between the seven sub partitions along with the three pivots.
+    element_type * partitionBegin,
+    element_type * partitionEnd,
+    get_key_function getKey,
+    prefetch_function prefetch
+) -> seven_way_partition<key_type>
 {
-    std::uint64_t partitionSize = std::distance(suffixArrayBegin, suffixArrayEnd);
-    if (partitionSize < 2)
-        return suffixArrayEnd;
-
-    if (currentMatchLength >= min_match_length_for_tandem_repeats)
-    {
-        if (currentMatchLength == min_match_length_for_tandem_repeats)
-            startingPattern = get_value(inputBegin_, *suffixArrayBegin);
-        if ((partitionSize > 1) && (has_potential_tandem_repeats(startingPattern, endingPattern)))
-            suffixArrayBegin += partition_tandem_repeats(suffixArrayBegin, suffixArrayEnd, currentMatchLength, tandemRepeatStack);
-        partitionSize = std::distance(suffixArrayBegin, suffixArrayEnd);
-    }
-    
-    if (partitionSize < insertion_sort_threshold)
-    {
-        multikey_insertion_sort(suffixArrayBegin, suffixArrayEnd, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
-        return suffixArrayEnd;
-    }
-
     // select three pivots
-    auto offsetInputBegin = inputBegin_ + currentMatchLength;
-    auto oneSixthOfPartitionSize = (partitionSize * 2863311531) >> 34; // divide by 6 ... crazy!
-    auto pivotCandidate1 = suffixArrayBegin + oneSixthOfPartitionSize;
+    auto oneSixthOfPartitionSize = (((std::uint64_t)std::distance(partitionBegin, partitionEnd)) * 2863311531) >> 34; // divide by 6 ... crazy!
+    auto pivotCandidate1 = partitionBegin + oneSixthOfPartitionSize;
     auto pivotCandidate2 = pivotCandidate1 + oneSixthOfPartitionSize;
     auto pivotCandidate3 = pivotCandidate2 + oneSixthOfPartitionSize;
     auto pivotCandidate4 = pivotCandidate3 + oneSixthOfPartitionSize;
     auto pivotCandidate5 = pivotCandidate4 + oneSixthOfPartitionSize;
-    auto pivotCandidateValue1 = get_value(offsetInputBegin, *pivotCandidate1);
-    auto pivotCandidateValue2 = get_value(offsetInputBegin, *pivotCandidate2);
-    auto pivotCandidateValue3 = get_value(offsetInputBegin, *pivotCandidate3);
-    auto pivotCandidateValue4 = get_value(offsetInputBegin, *pivotCandidate4);
-    auto pivotCandidateValue5 = get_value(offsetInputBegin, *pivotCandidate5);
+    auto pivotCandidateValue1 = getKey(*pivotCandidate1);
+    auto pivotCandidateValue2 = getKey(*pivotCandidate2);
+    auto pivotCandidateValue3 = getKey(*pivotCandidate3);
+    auto pivotCandidateValue4 = getKey(*pivotCandidate4);
+    auto pivotCandidateValue5 = getKey(*pivotCandidate5);
     if (pivotCandidateValue1 > pivotCandidateValue2)
         std::swap(*pivotCandidate1, *pivotCandidate2), std::swap(pivotCandidateValue1, pivotCandidateValue2);
     if (pivotCandidateValue4 > pivotCandidateValue5)
@@ -552,11 +1081,11 @@ auto maniscalco::msufsort::multikey_quicksort
     auto pivot3 = pivotCandidateValue5;
 
     // partition seven ways
-    auto curSuffix = suffixArrayBegin;
-    auto beginPivot1 = suffixArrayBegin;
-    auto endPivot1 = suffixArrayBegin;
-    auto beginPivot2 = suffixArrayBegin;
-    auto endPivot2 = suffixArrayEnd - 1;
+    auto curSuffix = partitionBegin;
+    auto beginPivot1 = partitionBegin;
+    auto endPivot1 = partitionBegin;
+    auto beginPivot2 = partitionBegin;
+    auto endPivot2 = partitionEnd - 1;
     auto beginPivot3 = endPivot2;
     auto endPivot3 = endPivot2;
 
@@ -569,16 +1098,18 @@ auto maniscalco::msufsort::multikey_quicksort
         std::swap(*endPivot2--, *pivotCandidate5);
         --beginPivot3;
     }
-    auto currentValue = get_value(offsetInputBegin, *curSuffix);
-    auto nextValue = get_value(offsetInputBegin, curSuffix[1]);
-    auto nextDValue = get_value(offsetInputBegin, *endPivot2);
+    auto currentValue = getKey(*curSuffix);
+    auto nextValue = getKey(curSuffix[1]);
+    auto nextDValue = getKey(*endPivot2);
 
     while (curSuffix <= endPivot2)
     {
         if (currentValue <= pivot2)
         {
             auto temp = nextValue;
-            nextValue = get_value(offsetInputBegin, curSuffix[2]);
+            if ((curSuffix + multikey_quicksort_prefetch_distance) <= endPivot2)
+                prefetch(curSuffix[multikey_quicksort_prefetch_distance]);
+            nextValue = getKey(curSuffix[2]);
             if (currentValue < pivot2)
             {
                 std::swap(*beginPivot2, *curSuffix);
@@ -595,7 +1126,9 @@ auto maniscalco::msufsort::multikey_quicksort
         }
         else
         {
-            auto nextValue = get_value(offsetInputBegin, endPivot2[-1]);
+            if ((endPivot2 - multikey_quicksort_prefetch_distance) >= curSuffix)
+                prefetch(endPivot2[-multikey_quicksort_prefetch_distance]);
+            auto nextValue = getKey(endPivot2[-1]);
             std::swap(*endPivot2, *curSuffix);
             if (currentValue >= pivot3)
             {
@@ -608,14 +1141,255 @@ auto maniscalco::msufsort::multikey_quicksort
             nextDValue = nextValue;
         }
     }
-    multikey_quicksort(suffixArrayBegin, beginPivot1, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
-    multikey_quicksort(beginPivot1, endPivot1, (currentMatchLength + sizeof(suffix_value)), startingPattern, {endingPattern[1], pivot1}, tandemRepeatStack);
-    multikey_quicksort(endPivot1, beginPivot2, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
-    multikey_quicksort(beginPivot2, ++endPivot2, (currentMatchLength + sizeof(suffix_value)), startingPattern, {endingPattern[1], pivot2}, tandemRepeatStack);
-    multikey_quicksort(endPivot2, ++beginPivot3, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
-    multikey_quicksort(beginPivot3, ++endPivot3, (currentMatchLength + sizeof(suffix_value)), startingPattern, {endingPattern[1], pivot3}, tandemRepeatStack);
-    multikey_quicksort(endPivot3, suffixArrayEnd, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
-    return suffixArrayEnd;
+    return {{{(std::size_t)std::distance(partitionBegin, beginPivot1), (std::size_t)std::distance(partitionBegin, endPivot1), 
+            (std::size_t)std::distance(partitionBegin, beginPivot2), (std::size_t)std::distance(partitionBegin, endPivot2 + 1), 
+            (std::size_t)std::distance(partitionBegin, beginPivot3 + 1), (std::size_t)std::distance(partitionBegin, endPivot3 + 1)}}, 
+            {{pivot1, pivot2, pivot3}}};
+}
+
+
+//==============================================================================
+template <typename digit_type>
+std::size_t maniscalco::msufsort::count_sampled_distinct_digits
+(
+    // private:
+    // returns the number of distinct digits found at offsetInputBegin among an evenly
+    // spaced sample of the suffixes.  used to decide if a radix partition is worthwhile.
+    // the per thread bitmap is cleared again by unmarking only the digits sampled.
+    suffix_index const * partitionBegin,
+    suffix_index const * partitionEnd,
+    uint8_t const * offsetInputBegin
+) const
+{
+    static std::size_t constexpr num_digits = (1ull << (8 * sizeof(digit_type)));
+    static thread_local std::array<std::uint64_t, (num_digits + 63) / 64> found{};
+    std::size_t distinctDigits = 0;
+    auto step = (std::distance(partitionBegin, partitionEnd) / radix_sample_size);
+    for (std::size_t i = 0; i < radix_sample_size; ++i)
+    {
+        std::size_t digit = get_value<digit_type>(offsetInputBegin, partitionBegin[i * step]);
+        auto bit = (1ull << (digit & 63));
+        distinctDigits += ((found[digit >> 6] & bit) == 0);
+        found[digit >> 6] |= bit;
+    }
+    for (std::size_t i = 0; i < radix_sample_size; ++i)
+    {
+        std::size_t digit = get_value<digit_type>(offsetInputBegin, partitionBegin[i * step]);
+        found[digit >> 6] = 0;
+    }
+    return distinctDigits;
+}
+
+
+//==============================================================================
+template <typename digit_type>
+auto maniscalco::msufsort::radix_partition
+(
+    // private:
+    // in place (american flag) radix sort of the suffixes on the digit found at offsetInputBegin.
+    // returns the size of the bucket for each possible digit value.
+    suffix_index * partitionBegin,
+    suffix_index * partitionEnd,
+    uint8_t const * offsetInputBegin
+) -> std::vector<suffix_index>
+{
+    static std::size_t constexpr num_buckets = (1ull << (8 * sizeof(digit_type)));
+    std::vector<suffix_index> bucketSize(num_buckets, 0);
+    for (auto cur = partitionBegin; cur < partitionEnd; ++cur)
+    {
+        if ((cur + multikey_quicksort_prefetch_distance) < partitionEnd)
+            prefetch_value(offsetInputBegin, cur[multikey_quicksort_prefetch_distance]);
+        ++bucketSize[get_value<digit_type>(offsetInputBegin, *cur)];
+    }
+
+    std::vector<suffix_index *> bucketNext(num_buckets);
+    std::vector<suffix_index *> bucketEnd(num_buckets);
+    auto cur = partitionBegin;
+    for (std::size_t i = 0; i < num_buckets; ++i)
+    {
+        bucketNext[i] = cur;
+        cur += bucketSize[i];
+        bucketEnd[i] = cur;
+    }
+
+    // each suffix is swapped directly into its bucket until the suffix which belongs at the
+    // current position is found.
+    for (std::size_t i = 0; i < num_buckets; ++i)
+    {
+        while (bucketNext[i] < bucketEnd[i])
+        {
+            auto suffix = *bucketNext[i];
+            auto digit = get_value<digit_type>(offsetInputBegin, suffix);
+            while (digit != i)
+            {
+                auto & destination = *bucketNext[digit]++;
+                std::swap(suffix, destination);
+                digit = get_value<digit_type>(offsetInputBegin, suffix);
+            }
+            *bucketNext[i]++ = suffix;
+        }
+    }
+    return bucketSize;
+}
+
+
+//==============================================================================
+template <typename key_type>
+auto maniscalco::msufsort::multikey_quicksort
+(
+    // private:
+    // multi key quicksort on the input data provided
+    suffix_index * suffixArrayBegin,
+    suffix_index * suffixArrayEnd,
+    suffix_index currentMatchLength,
+    key_type startingPattern,
+    std::array<key_type, 2> endingPattern,
+    std::vector<tandem_repeat_info> & tandemRepeatStack,
+    partition_task_deque<key_type> * partitionTaskDeque,
+    cached_key<key_type> * keyCache
+) -> suffix_index *
+{
+    auto const partitionEnd = suffixArrayEnd;
+    while (true)
+    {
+        std::uint64_t partitionSize = std::distance(suffixArrayBegin, suffixArrayEnd);
+        if ((partitionSize < 2) || (direct_sort_abandoned()))
+            return partitionEnd;
+        if ((currentMatchLength >= direct_sort_budget_min_match_length) && (!charge_direct_sort_budget(partitionSize)))
+            return partitionEnd;
+
+        if (currentMatchLength >= min_match_length_for_tandem_repeats<key_type>)
+        {
+            // the radix partitioning advances the match length by less than sizeof(key_type) so capture
+            // the starting pattern on the first match length at or beyond the minimum
+            if (currentMatchLength < (suffix_index)(min_match_length_for_tandem_repeats<key_type> + sizeof(key_type)))
+                startingPattern = get_value<key_type>(inputBegin_, *suffixArrayBegin);
+            if ((partitionSize > 1) && (has_potential_tandem_repeats<key_type>(startingPattern, endingPattern)))
+                suffixArrayBegin += partition_tandem_repeats(suffixArrayBegin, suffixArrayEnd, currentMatchLength, tandemRepeatStack);
+            partitionSize = std::distance(suffixArrayBegin, suffixArrayEnd);
+        }
+    
+        if (partitionSize < insertion_sort_threshold)
+        {
+            multikey_insertion_sort(suffixArrayBegin, suffixArrayEnd, currentMatchLength, startingPattern, endingPattern, tandemRepeatStack);
+            return partitionEnd;
+        }
+
+        struct sub_partition
+        {
+            suffix_index * begin_;
+            suffix_index * end_;
+            suffix_index matchLength_;
+            std::array<key_type, 2> endingPattern_;
+        };
+        auto sortSubPartitions = [&](sub_partition * begin, sub_partition * end) -> sub_partition *
+                {
+                    // recurse on the smaller partitions and return the largest to iterate on.  each recursion is then 
+                    // on at most half of the current partition which bounds the stack depth regardless of how deep
+                    // the common prefixes of a repetitive partition are.
+                    auto largest = std::max_element(begin, end, [](sub_partition const & a, sub_partition const & b) -> bool
+                            {return (std::distance(a.begin_, a.end_) < std::distance(b.begin_, b.end_));});
+                    for (auto subPartition = begin; subPartition != end; ++subPartition)
+                    {
+                        if (subPartition == largest)
+                            continue;
+                        if ((partitionTaskDeque != nullptr) && (std::distance(subPartition->begin_, subPartition->end_) >= min_parallel_partition_size))
+                        {
+                            // large enough to be worth sharing with idle threads
+                            post_partition_task(*partitionTaskDeque, {subPartition->begin_, subPartition->end_, subPartition->matchLength_, startingPattern, subPartition->endingPattern_});
+                        }
+                        else
+                        {
+                            multikey_quicksort(subPartition->begin_, subPartition->end_, subPartition->matchLength_, startingPattern, subPartition->endingPattern_, tandemRepeatStack, partitionTaskDeque, keyCache);
+                        }
+                    }
+                    return largest;
+                };
+
+        auto offsetInputBegin = inputBegin_ + currentMatchLength;
+        auto twoByteRadix = ((partitionSize >= min_two_byte_radix_partition_size) && 
+                (count_sampled_distinct_digits<std::uint16_t>(suffixArrayBegin, suffixArrayEnd, offsetInputBegin) >= min_radix_distinct_digits));
+        if ((twoByteRadix) || ((partitionSize >= min_radix_partition_size) && 
+                (count_sampled_distinct_digits<std::uint8_t>(suffixArrayBegin, suffixArrayEnd, offsetInputBegin) >= min_radix_distinct_digits)))
+        {
+            // large partition with many distinct digits.  radix sort on the next one or two bytes.
+            auto bucketSize = twoByteRadix ? radix_partition<std::uint16_t>(suffixArrayBegin, suffixArrayEnd, offsetInputBegin) : 
+                    radix_partition<std::uint8_t>(suffixArrayBegin, suffixArrayEnd, offsetInputBegin);
+            suffix_index nextMatchLength = (currentMatchLength + (twoByteRadix ? 2 : 1));
+            std::vector<sub_partition> subPartitions;
+            auto bucketBegin = suffixArrayBegin;
+            for (auto size : bucketSize)
+            {
+                if (size > 0)
+                {
+                    // the ending pattern is the last two keys matched by all suffixes in the bucket
+                    std::array<key_type, 2> bucketEndingPattern{{0, 0}};
+                    if (nextMatchLength >= (suffix_index)sizeof(key_type))
+                        bucketEndingPattern[1] = get_value<key_type>(inputBegin_ + nextMatchLength - sizeof(key_type), *bucketBegin);
+                    if (nextMatchLength >= (suffix_index)(sizeof(key_type) << 1))
+                        bucketEndingPattern[0] = get_value<key_type>(inputBegin_ + nextMatchLength - (sizeof(key_type) << 1), *bucketBegin);
+                    subPartitions.push_back({bucketBegin, bucketBegin + size, nextMatchLength, bucketEndingPattern});
+                    bucketBegin += size;
+                }
+            }
+            auto largest = sortSubPartitions(subPartitions.data(), subPartitions.data() + subPartitions.size());
+            suffixArrayBegin = largest->begin_;
+            suffixArrayEnd = largest->end_;
+            currentMatchLength = largest->matchLength_;
+            endingPattern = largest->endingPattern_;
+            continue;
+        }
+
+        // partition seven ways.  large partitions first load their keys into the key cache in a 
+        // single streaming pass and then partition the cache rather than chasing each suffix into the text.
+        seven_way_partition<key_type> partition;
+        if ((keyCache != nullptr) && (partitionSize >= min_key_cache_partition_size) && (partitionSize <= key_cache_size))
+        {
+            for (std::size_t i = 0; i < partitionSize; ++i)
+            {
+                if ((i + multikey_quicksort_prefetch_distance) < partitionSize)
+                    prefetch_value(offsetInputBegin, suffixArrayBegin[i + multikey_quicksort_prefetch_distance]);
+                keyCache[i] = {get_value<key_type>(offsetInputBegin, suffixArrayBegin[i]), suffixArrayBegin[i]};
+            }
+            keyCache[partitionSize] = keyCache[partitionSize + 1] = {0, 0}; // the partition loop reads ahead
+            partition = partition_seven_ways<key_type>(keyCache, keyCache + partitionSize, 
+                    [](cached_key<key_type> const & cachedKey){return cachedKey.value_;}, [](cached_key<key_type> const &){});
+            for (std::size_t i = 0; i < partitionSize; ++i)
+                suffixArrayBegin[i] = keyCache[i].index_;
+        }
+        else
+        {
+            partition = partition_seven_ways<key_type>(suffixArrayBegin, suffixArrayEnd, 
+                    [&](suffix_index index){return get_value<key_type>(offsetInputBegin, index);}, 
+                    [&](suffix_index index){prefetch_value(offsetInputBegin, index);});
+        }
+        auto beginPivot1 = suffixArrayBegin + partition.boundaries_[0];
+        auto endPivot1 = suffixArrayBegin + partition.boundaries_[1];
+        auto beginPivot2 = suffixArrayBegin + partition.boundaries_[2];
+        auto endPivot2 = suffixArrayBegin + partition.boundaries_[3];
+        auto beginPivot3 = suffixArrayBegin + partition.boundaries_[4];
+        auto endPivot3 = suffixArrayBegin + partition.boundaries_[5];
+        auto pivot1 = partition.pivots_[0];
+        auto pivot2 = partition.pivots_[1];
+        auto pivot3 = partition.pivots_[2];
+
+        suffix_index nextMatchLength = (currentMatchLength + sizeof(key_type));
+        sub_partition subPartitions[] = 
+        {
+            {suffixArrayBegin, beginPivot1, currentMatchLength, endingPattern},
+            {beginPivot1, endPivot1, nextMatchLength, {endingPattern[1], pivot1}},
+            {endPivot1, beginPivot2, currentMatchLength, endingPattern},
+            {beginPivot2, endPivot2, nextMatchLength, {endingPattern[1], pivot2}},
+            {endPivot2, beginPivot3, currentMatchLength, endingPattern},
+            {beginPivot3, endPivot3, nextMatchLength, {endingPattern[1], pivot3}},
+            {endPivot3, suffixArrayEnd, currentMatchLength, endingPattern}
+        };
+        auto largest = sortSubPartitions(std::begin(subPartitions), std::end(subPartitions));
+        suffixArrayBegin = largest->begin_;
+        suffixArrayEnd = largest->end_;
+        currentMatchLength = largest->matchLength_;
+        endingPattern = largest->endingPattern_;
+    }
 }
 
 
@@ -632,7 +1406,7 @@ void maniscalco::msufsort::second_stage_its_right_to_left_pass_multi_threaded
     struct entry_type
     {
         uint8_t precedingSuffix_;
-        int32_t precedingSuffixIndex_;
+        suffix_index precedingSuffixIndex_;
     };
     std::unique_ptr<entry_type []> cache[numThreads];
     for (auto i = 0; i < numThreads; ++i)
@@ -694,10 +1468,10 @@ void maniscalco::msufsort::second_stage_its_right_to_left_pass_multi_threaded
                         {
                             if ((*begin & preceding_suffix_is_type_a_flag) == 0)
                             {
-                                int32_t precedingSuffixIndex = ((*begin & sa_index_mask) - 1);
+                                suffix_index precedingSuffixIndex = ((*begin & sa_index_mask) - 1);
                                 auto precedingSuffix = (inputBegin + precedingSuffixIndex);
                                 auto precedingSymbol = precedingSuffix[0];
-                                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
+                                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
                                 *curCache++ = {precedingSymbol, precedingSuffixIndex | flag};
                                 if (precedingSymbol != currentPrecedingSymbol)
                                 {
@@ -787,10 +1561,10 @@ void maniscalco::msufsort::second_stage_its_right_to_left_pass_single_threaded
         {
             if ((*currentSuffix & preceding_suffix_is_type_a_flag) == 0)
             {
-                int32_t precedingSuffixIndex = ((*currentSuffix & sa_index_mask) - 1);
+                suffix_index precedingSuffixIndex = ((*currentSuffix & sa_index_mask) - 1);
                 auto precedingSuffix = (inputBegin_ + precedingSuffixIndex);
                 auto precedingSymbol = precedingSuffix[0];
-                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
+                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
                 if (precedingSymbol != previousPrecedingSymbol)
                 {
                     previousPrecedingSymbol = precedingSymbol;
@@ -823,10 +1597,10 @@ void maniscalco::msufsort::second_stage_its_left_to_right_pass_single_threaded
         {
             if ((currentSuffixIndex & sa_index_mask) != 0)
             {
-                int32_t precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
+                suffix_index precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
                 auto precedingSuffix = (inputBegin_ + precedingSuffixIndex);
                 auto precedingSymbol = precedingSuffix[0];
-                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
+                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
                 if (precedingSymbol != previousPrecedingSymbol)
                 {
                     previousPrecedingSymbol = precedingSymbol;
@@ -854,7 +1628,7 @@ void maniscalco::msufsort::second_stage_its_left_to_right_pass_multi_threaded
     struct entry_type
     {
         uint8_t precedingSuffix_;
-        int32_t precedingSuffixIndex_;
+        suffix_index precedingSuffixIndex_;
     };
     std::unique_ptr<entry_type []> cache[numThreads];
     for (auto i = 0; i < numThreads; ++i)
@@ -884,7 +1658,7 @@ void maniscalco::msufsort::second_stage_its_left_to_right_pass_multi_threaded
         if (maxEnd > suffixArrayEnd_)
             maxEnd = suffixArrayEnd_;
         currentSuffix += (currentSuffix != maxEnd);
-        while ((currentSuffix != maxEnd) && (*currentSuffix != (int32_t)0x80000000))
+        while ((currentSuffix != maxEnd) && (*currentSuffix != preceding_suffix_is_type_a_flag))
             ++currentSuffix;
         auto end = currentSuffix;
         auto totalSuffixes = std::distance(begin, end);
@@ -922,10 +1696,10 @@ void maniscalco::msufsort::second_stage_its_left_to_right_pass_multi_threaded
                             currentSuffixIndex &= sa_index_mask;
                             if (currentSuffixIndex != 0)
                             {
-                                int32_t precedingSuffixIndex = (currentSuffixIndex - 1);
+                                suffix_index precedingSuffixIndex = (currentSuffixIndex - 1);
                                 auto precedingSuffix = (inputBegin + precedingSuffixIndex);
                                 auto precedingSymbol = precedingSuffix[0];
-                                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
+                                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
                                 *curCache++ = {precedingSymbol, precedingSuffixIndex | flag};
                                 if (precedingSymbol != currentPrecedingSymbol)
                                 {
@@ -1034,6 +1808,33 @@ void maniscalco::msufsort::second_stage_its
 }
 
 
+//==============================================================================
+inline bool maniscalco::msufsort::is_anchor
+(
+    // private:
+    // returns true if the sorted index of the suffix is to be recorded as an anchor
+    suffix_index suffixIndex
+) const
+{
+    return ((anchors_ != nullptr) && ((suffixIndex & anchorIntervalMask_) == 0));
+}
+
+
+//==============================================================================
+inline void maniscalco::msufsort::record_anchor
+(
+    // private:
+    // records the sorted index of the suffix if it is an anchor.  'suffix' is
+    // the suffix's final location in the suffix array.
+    suffix_index suffixIndex,
+    suffix_index const * suffix
+)
+{
+    if (is_anchor(suffixIndex))
+        anchors_[suffixIndex >> anchorIntervalShift_] = (suffix_index)std::distance((suffix_index const *)suffixArrayBegin_, suffix);
+}
+
+
 //==============================================================================
 void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_to_left_pass_single_threaded
 (
@@ -1051,18 +1852,19 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
         auto endSuffix = currentSuffix - bCount_[i];
         while (currentSuffix > endSuffix)
         {
-            int32_t precedingSuffixIndex = ((*currentSuffix & sa_index_mask) - 1);
+            suffix_index precedingSuffixIndex = ((*currentSuffix & sa_index_mask) - 1);
             auto precedingSuffix = (inputBegin_ + precedingSuffixIndex);
             auto precedingSymbol = precedingSuffix[0];
             if ((*currentSuffix & preceding_suffix_is_type_a_flag) == 0)
             {
-                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
+                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
                 if (precedingSymbol != previousPrecedingSymbol)
                 {
                     previousPrecedingSymbol = precedingSymbol;
                     prevWrite = backBucketOffset + previousPrecedingSymbol;
                 }
                 *(--*prevWrite) = (precedingSuffixIndex | flag);
+                record_anchor(precedingSuffixIndex + 1, currentSuffix);
                 if (precedingSuffix >= inputBegin_)
                     *currentSuffix = precedingSymbol;
             }
@@ -1086,7 +1888,7 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
     struct entry_type
     {
         uint8_t precedingSuffix_;
-        int32_t precedingSuffixIndex_;
+        suffix_index precedingSuffixIndex_;
     };
     std::unique_ptr<entry_type []> cache[numThreads];
     for (auto i = 0; i < numThreads; ++i)
@@ -1132,7 +1934,7 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
                 post_task_to_thread
                 (
                     threadId, 
-                    [](
+                    [this](
                         uint8_t const * inputBegin,
                         suffix_index * begin,
                         suffix_index * end,
@@ -1150,10 +1952,10 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
                             auto currentSuffixIndex = *begin;
                             if ((currentSuffixIndex & preceding_suffix_is_type_a_flag) == 0)
                             {
-                                int32_t precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
+                                suffix_index precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
                                 auto precedingSuffix = (inputBegin + precedingSuffixIndex);
                                 auto precedingSymbol = precedingSuffix[0];
-                                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
+                                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] <= precedingSymbol)) ? 0 : preceding_suffix_is_type_a_flag;
                                 *curCache++ = {precedingSymbol, precedingSuffixIndex | flag};
                                 if (precedingSymbol != currentPrecedingSymbol)
                                 {
@@ -1162,6 +1964,7 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
                                     currentPrecedingSymbolCount = 0;
                                 }
                                 ++currentPrecedingSymbolCount;
+                                record_anchor(precedingSuffixIndex + 1, begin);
                                 if (precedingSuffixIndex >= 0)
                                     *begin = precedingSymbol;
                             }
@@ -1225,12 +2028,12 @@ void maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_right_t
 
 
 //==============================================================================
-int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_single_threaded
+auto maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_single_threaded
 (
     // private:
     // induce sorted position of A suffixes from sorted B suffixes
     // This is the second half of the second stage of the ITS ... the 'left to right' pass
-)
+) -> suffix_index
 {
     auto sentinel = suffixArrayBegin_;
     auto currentSuffix = suffixArrayBegin_ - 1;
@@ -1241,12 +2044,12 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
         auto currentSuffixIndex = *currentSuffix;
         if (currentSuffixIndex & preceding_suffix_is_type_a_flag)
         {
-            int32_t precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
+            suffix_index precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
             auto precedingSuffix = (inputBegin_ + precedingSuffixIndex);
             if ((currentSuffixIndex & sa_index_mask) != 0)
             {
                 auto precedingSymbol = precedingSuffix[0];
-                int32_t flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
+                suffix_index flag = ((precedingSuffixIndex > 0) && (precedingSuffix[-1] >= precedingSymbol)) ? preceding_suffix_is_type_a_flag : 0;
                 if (precedingSymbol != previousPrecedingSymbol)
                 {
                     previousPrecedingSymbol = precedingSymbol;
@@ -1254,27 +2057,36 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
                 }
                 if (flag)
                     *((*previousFrontBucketOffset)++) = (precedingSuffixIndex | flag);
+                else if ((precedingSuffixIndex > 0) && (is_anchor(precedingSuffixIndex)))
+                    *((*previousFrontBucketOffset)++) = (precedingSuffixIndex | suffix_is_anchor_flag);
                 else
                     *((*previousFrontBucketOffset)++) = ((precedingSuffixIndex > 0) ? precedingSuffix[-1] : preceding_suffix_is_type_a_flag);
             }
+            record_anchor(precedingSuffixIndex + 1, currentSuffix);
             if (precedingSuffixIndex >= 0)
                 *currentSuffix = *precedingSuffix;
             else
                 sentinel = currentSuffix;
         }
+        else if (currentSuffixIndex & suffix_is_anchor_flag)
+        {
+            // an anchor whose preceding suffix is type B.  its symbol was held back until its sorted index was known.
+            record_anchor(currentSuffixIndex & sa_index_mask, currentSuffix);
+            *currentSuffix = inputBegin_[(currentSuffixIndex & sa_index_mask) - 1];
+        }
     }
-    int32_t sentinelIndex = (int32_t)std::distance(suffixArrayBegin_, sentinel);
+    suffix_index sentinelIndex = (suffix_index)std::distance(suffixArrayBegin_, sentinel);
     return sentinelIndex;
 }
 
 
 //==============================================================================
-int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_multi_threaded
+auto maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_multi_threaded
 (
     // private:
     // induce sorted position of A suffixes from sorted B suffixes
     // This is the second half of the second stage of the ITS ... the 'left to right' pass
-)
+) -> suffix_index
 {
     auto sentinel = suffixArrayBegin_;
     auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
@@ -1283,7 +2095,7 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
     struct entry_type
     {
         uint8_t precedingSuffix_;
-        int32_t precedingSuffixIndex_;
+        suffix_index precedingSuffixIndex_;
     };
     std::unique_ptr<entry_type []> cache[numThreads];
     for (auto i = 0; i < numThreads; ++i)
@@ -1308,7 +2120,7 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
         if (maxEnd > suffixArrayEnd_)
             maxEnd = suffixArrayEnd_;
         currentSuffix += (currentSuffix != maxEnd);
-        while ((currentSuffix != maxEnd) && (*currentSuffix != (int32_t)0x80000000))
+        while ((currentSuffix != maxEnd) && (*currentSuffix != preceding_suffix_is_type_a_flag))
             ++currentSuffix;
         auto end = currentSuffix;
         auto totalSuffixes = std::distance(begin, end);
@@ -1324,7 +2136,7 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
             post_task_to_thread
             (
                 threadId, 
-                [&sentinel](
+                [this, &sentinel](
                     uint8_t const * inputBegin,
                     suffix_index * begin,
                     suffix_index * end,
@@ -1343,15 +2155,17 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
                         auto currentSuffixIndex = *current;
                         if (currentSuffixIndex & preceding_suffix_is_type_a_flag)
                         {
-                            int32_t precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
+                            suffix_index precedingSuffixIndex = ((currentSuffixIndex & sa_index_mask) - 1);
                             auto precedingSuffix = (inputBegin + precedingSuffixIndex);
                             if ((currentSuffixIndex & sa_index_mask) != 0)
                             {
                                 auto precedingSymbol = precedingSuffix[0];
                                 bool precedingSuffixIsTypeA = ((precedingSuffixIndex == 0) || (precedingSuffix[-1] >= precedingSymbol));
-                                int32_t flag = (precedingSuffixIsTypeA) ? preceding_suffix_is_type_a_flag : 0;
+                                suffix_index flag = (precedingSuffixIsTypeA) ? preceding_suffix_is_type_a_flag : 0;
                                 if (flag)
                                     *curCache++ = {precedingSymbol, precedingSuffixIndex | flag};
+                                else if ((precedingSuffixIndex > 0) && (is_anchor(precedingSuffixIndex)))
+                                    *curCache++ = {precedingSymbol, precedingSuffixIndex | suffix_is_anchor_flag};
                                 else
                                     *curCache++ = {precedingSymbol, (precedingSuffixIndex > 0) ? precedingSuffix[-1] : 0};
                                 if (precedingSymbol != currentPrecedingSymbol)
@@ -1362,11 +2176,17 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
                                 }
                                 ++currentPrecedingSymbolCount;
                             }
+                            record_anchor(precedingSuffixIndex + 1, current);
                             if (precedingSuffixIndex >= 0)
                                 *current = precedingSuffix[0];
                             else
                                 sentinel = current;
                         }
+                        else if (currentSuffixIndex & suffix_is_anchor_flag)
+                        {
+                            record_anchor(currentSuffixIndex & sa_index_mask, current);
+                            *current = inputBegin[(currentSuffixIndex & sa_index_mask) - 1];
+                        }
                     }
                     suffixCount[currentPrecedingSymbol] += currentPrecedingSymbolCount;
                     numSuffixes = std::distance(cache, curCache);
@@ -1421,18 +2241,18 @@ int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform_left
             );
         wait_for_all_tasks_completed();
     }
-    int32_t sentinelIndex = (int32_t)std::distance(suffixArrayBegin_, sentinel);
+    suffix_index sentinelIndex = (suffix_index)std::distance(suffixArrayBegin_, sentinel);
     return sentinelIndex;
 }
 
 
 //==============================================================================
-int32_t maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform
+auto maniscalco::msufsort::second_stage_its_as_burrows_wheeler_transform
 (
     // private:
     // creates the burrows wheeler transform while completing the second stage
     // of the improved two stage sort.
-)
+) -> suffix_index
 {
     if (numWorkerThreads_ == 0)
     {
@@ -1474,7 +2294,7 @@ void maniscalco::msufsort::count_suffixes
 (
     uint8_t const * begin,
     uint8_t const * end,
-    std::array<int32_t *, 4> count
+    std::array<suffix_index *, 4> count
 )
 {
     if (begin < end)
@@ -1503,7 +2323,7 @@ void maniscalco::msufsort::initial_two_byte_radix_sort
 (
     uint8_t const * begin,
     uint8_t const * end,
-    int32_t * bStarOffset
+    suffix_index * bStarOffset
 )
 {
     if (begin < end)
@@ -1520,7 +2340,7 @@ void maniscalco::msufsort::initial_two_byte_radix_sort
     {
         if ((state & 0x03) == 2)
         {
-            int32_t flag = ((current > inputBegin_) && (current[-1] <= current[0])) ? 0 : preceding_suffix_is_type_a_flag;
+            suffix_index flag = ((current > inputBegin_) && (current[-1] <= current[0])) ? 0 : preceding_suffix_is_type_a_flag;
             suffixArrayBegin_[bStarOffset[endian_swap<host_order_type, big_endian_type>(*(uint16_t const *)current)]++] = 
                         (std::distance(inputBegin_, current) | flag);
         }
@@ -1532,6 +2352,199 @@ void maniscalco::msufsort::initial_two_byte_radix_sort
 }
 
 
+//==============================================================================
+template <typename symbol_type>
+void maniscalco::msufsort::induced_sort
+(
+    // private:
+    // SA-IS (Nong, Zhang and Chan) suffix sort of text[0, size) over the alphabet [0, alphabetSize).
+    // writes (size + 1) entries to suffixArray with the (virtual) sentinel suffix at suffixArray[0].
+    // sorts the lms substrings by induction, names them and recurses on the reduced string
+    // which is at most half the length of the text.  linear time for any input.
+    // the suffix types (one bit each) and the buckets are kept in the workspace when they fit.  
+    // the recursion passes the part of the suffix array between the reduced suffix array and the 
+    // reduced string as its workspace.
+    symbol_type const * text,
+    suffix_index * suffixArray,
+    suffix_index size,
+    suffix_index alphabetSize,
+    suffix_index * workspace,
+    suffix_index workspaceSize
+)
+{
+    static suffix_index constexpr empty = -1;
+    static suffix_index constexpr type_bits = (sizeof(suffix_index) * 8);
+    suffixArray[0] = size;
+    if (size < 2)
+    {
+        if (size == 1)
+            suffixArray[1] = 0;
+        return;
+    }
+
+    // the bucket sizes are kept only if they fit in the workspace too.  otherwise they are counted 
+    // again each time the buckets are set.  the top level, which has no workspace, keeps them.
+    auto typeSize = ((size + type_bits) / type_bits);
+    std::vector<suffix_index> allocatedWorkspace;
+    if (workspaceSize < (typeSize + alphabetSize))
+    {
+        workspaceSize = ((workspace == nullptr) ? (typeSize + (alphabetSize << 1)) : (typeSize + alphabetSize));
+        allocatedWorkspace.resize(workspaceSize);
+        workspace = allocatedWorkspace.data();
+    }
+    using type_word = std::make_unsigned<suffix_index>::type;
+    auto typeS = (type_word *)workspace;
+    auto bucket = (workspace + typeSize);
+    auto bucketSize = (workspaceSize >= (typeSize + (alphabetSize << 1))) ? (bucket + alphabetSize) : nullptr;
+
+    // type S (B) = 1, type L (A) = 0.  the sentinel is type S
+    auto is_type_s = [&](suffix_index i) -> bool{return ((typeS[i / type_bits] >> (i % type_bits)) & 1);};
+    auto set_type_s = [&](suffix_index i){typeS[i / type_bits] |= ((type_word)1 << (i % type_bits));};
+    std::fill(typeS, typeS + typeSize, 0);
+    set_type_s(size);
+    for (auto i = size - 2; i >= 0; --i)
+        if ((text[i] < text[i + 1]) || ((text[i] == text[i + 1]) && (is_type_s(i + 1))))
+            set_type_s(i);
+    auto is_lms = [&](suffix_index i) -> bool{return ((i > 0) && (is_type_s(i)) && (!is_type_s(i - 1)));};
+
+    // suffixArray[0] is reserved for the sentinel so buckets begin at 1
+    auto count_symbols = [&](suffix_index * count)
+    {
+        std::fill(count, count + alphabetSize, 0);
+        for (suffix_index i = 0; i < size; ++i)
+            ++count[text[i]];
+    };
+    if (bucketSize != nullptr)
+        count_symbols(bucketSize);
+    auto set_buckets = [&](bool bucketBacks)
+    {
+        if (bucketSize == nullptr)
+            count_symbols(bucket);
+        auto count = (bucketSize == nullptr) ? bucket : bucketSize;
+        suffix_index total = 1;
+        for (suffix_index symbol = 0; symbol < alphabetSize; ++symbol)
+        {
+            auto symbolCount = count[symbol];
+            bucket[symbol] = (bucketBacks) ? (total + symbolCount) : total;
+            total += symbolCount;
+        }
+    };
+    auto set_bucket_fronts = [&](){set_buckets(false);};
+    auto set_bucket_backs = [&](){set_buckets(true);};
+    auto induce = [&]()
+    {
+        // induce type L from lms seeds (left to right) and then type S from type L (right to left)
+        set_bucket_fronts();
+        for (suffix_index i = 0; i <= size; ++i)
+            if ((suffixArray[i] > 0) && (!is_type_s(suffixArray[i] - 1)))
+                suffixArray[bucket[text[suffixArray[i] - 1]]++] = (suffixArray[i] - 1);
+        set_bucket_backs();
+        for (suffix_index i = size; i >= 0; --i)
+            if ((suffixArray[i] > 0) && (is_type_s(suffixArray[i] - 1)))
+                suffixArray[--bucket[text[suffixArray[i] - 1]]] = (suffixArray[i] - 1);
+    };
+
+    // sort the lms substrings
+    std::fill(suffixArray, suffixArray + size + 1, empty);
+    set_bucket_backs();
+    for (suffix_index i = 1; i < size; ++i)
+        if (is_lms(i))
+            suffixArray[--bucket[text[i]]] = i;
+    suffixArray[0] = size;
+    induce();
+
+    // compact the sorted lms substrings (sentinel excluded) into the front of the suffix array
+    suffix_index lmsCount = 0;
+    for (suffix_index i = 1; i <= size; ++i)
+        if (is_lms(suffixArray[i]))
+            suffixArray[lmsCount++] = suffixArray[i];
+
+    // name the lms substrings.  lms suffixes are never adjacent so (index / 2) is unique
+    std::fill(suffixArray + lmsCount, suffixArray + size + 1, empty);
+    suffix_index name = 0;
+    suffix_index previous = -1;
+    for (suffix_index i = 0; i < lmsCount; ++i)
+    {
+        auto current = suffixArray[i];
+        bool different = (previous < 0);
+        for (suffix_index d = 0; !different; ++d)
+        {
+            if (((current + d) == size) || ((previous + d) == size) || (text[current + d] != text[previous + d]) ||
+                    (is_type_s(current + d) != is_type_s(previous + d)))
+                different = true;
+            else if ((d > 0) && ((is_lms(current + d)) || (is_lms(previous + d))))
+                break;
+        }
+        if (different)
+        {
+            ++name;
+            previous = current;
+        }
+        suffixArray[lmsCount + (current >> 1)] = (name - 1);
+    }
+
+    // gather the reduced string (in text order) at the back of the suffix array and sort it.  
+    // recurse only if the names are not already unique.  the recursion uses the suffix array
+    // between its own (lmsCount + 1) entries and the reduced string as its workspace.
+    for (suffix_index i = size, j = size; i >= lmsCount; --i)
+        if (suffixArray[i] != empty)
+            suffixArray[j--] = suffixArray[i];
+    auto reducedText = (suffixArray + size + 1 - lmsCount);
+    if (name < lmsCount)
+    {
+        induced_sort<suffix_index>(reducedText, suffixArray, lmsCount, name, suffixArray + lmsCount + 1, size - (lmsCount << 1));
+    }
+    else
+    {
+        suffixArray[0] = lmsCount;
+        for (suffix_index i = 0; i < lmsCount; ++i)
+            suffixArray[reducedText[i] + 1] = i;
+    }
+
+    // map the sorted reduced suffixes back to lms suffixes and induce the final order from them
+    for (suffix_index i = 1, j = 0; i < size; ++i)
+        if (is_lms(i))
+            reducedText[j++] = i;
+    for (suffix_index i = 0; i < lmsCount; ++i)
+        suffixArray[i] = reducedText[suffixArray[i + 1]];
+    std::fill(suffixArray + lmsCount, suffixArray + size + 1, empty);
+    set_bucket_backs();
+    for (auto i = lmsCount - 1; i >= 0; --i)
+    {
+        auto lms = suffixArray[i];
+        suffixArray[i] = empty;
+        suffixArray[--bucket[text[lms]]] = lms;
+    }
+    suffixArray[0] = size;
+    induce();
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::induced_sort_b_star_suffixes
+(
+    // private:
+    // fallback for deeply repetitive input.  replaces the B* partitions produced by the
+    // direct sort with the B* suffixes in sorted order as determined by induced sorting.
+    // upon completion the B* suffixes are packed at the front of the suffix array exactly
+    // as the direct sort would have left them.
+)
+{
+    induced_sort<std::uint8_t>(inputBegin_, suffixArrayBegin_, inputSize_, 0x100);
+    auto bStarCurrent = suffixArrayBegin_;
+    for (auto currentSuffix = suffixArrayBegin_ + 1; currentSuffix < suffixArrayEnd_; ++currentSuffix)
+    {
+        auto suffixIndex = *currentSuffix;
+        auto suffix = (inputBegin_ + suffixIndex);
+        if (((suffix + 1) < inputEnd_) && (suffix[0] < suffix[1]) && (get_suffix_type(suffix) == bStar))
+        {
+            suffix_index flag = ((suffixIndex > 0) && (suffix[-1] <= suffix[0])) ? 0 : preceding_suffix_is_type_a_flag;
+            *bStarCurrent++ = (suffixIndex | flag);
+        }
+    }
+}
+
+
 //==============================================================================
 void maniscalco::msufsort::first_stage_its
 (
@@ -1541,14 +2554,14 @@ void maniscalco::msufsort::first_stage_its
 {
     auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
     auto start = std::chrono::system_clock::now();
-    std::unique_ptr<int32_t []> bCount(new int32_t[0x10000]{});
-    std::unique_ptr<int32_t []> aCount(new int32_t[0x10000]{});
-    std::unique_ptr<int32_t []> bStarCount(new int32_t[numThreads * 0x10000]{});
+    std::unique_ptr<suffix_index []> bCount(new suffix_index[0x10000]{});
+    std::unique_ptr<suffix_index []> aCount(new suffix_index[0x10000]{});
+    std::unique_ptr<suffix_index []> bStarCount(new suffix_index[numThreads * 0x10000]{});
     auto numSuffixesPerThread = ((inputSize_ + numThreads - 1) / numThreads);
 
     {
-        std::unique_ptr<int32_t []> threadBCount(new int32_t[numThreads * 0x10000]{});
-        std::unique_ptr<int32_t []> threadACount(new int32_t[numThreads * 0x10000]{});
+        std::unique_ptr<suffix_index []> threadBCount(new suffix_index[numThreads * 0x10000]{});
+        std::unique_ptr<suffix_index []> threadACount(new suffix_index[numThreads * 0x10000]{});
         auto inputCurrent = inputBegin_;
         for (auto threadId = 0; threadId < numThreads; ++threadId)
         {
@@ -1556,7 +2569,7 @@ void maniscalco::msufsort::first_stage_its
             if (inputEnd > (inputEnd_ - 1))
                 inputEnd = (inputEnd_ - 1);
             auto arrayOffset = (threadId * 0x10000);
-            std::array<int32_t *, 4> c({threadBCount.get() + arrayOffset, threadACount.get() + arrayOffset, bStarCount.get() + arrayOffset, threadACount.get() + arrayOffset});
+            std::array<suffix_index *, 4> c({threadBCount.get() + arrayOffset, threadACount.get() + arrayOffset, bStarCount.get() + arrayOffset, threadACount.get() + arrayOffset});
             post_task_to_thread(threadId, &msufsort::count_suffixes, this, inputEnd - 1, inputCurrent, c);
             inputCurrent = inputEnd;
         }
@@ -1564,47 +2577,125 @@ void maniscalco::msufsort::first_stage_its
 
         ++aCount[((uint16_t)inputEnd_[-1]) << 8];
         ++aCount_[inputEnd_[-1]];
+
+        // merge the per thread counts.  each thread merges the buckets for its own range of first symbols.
         for (auto threadId = 0; threadId < numThreads; ++threadId)
         {
-            auto arrayOffset = (threadId * 0x10000);
-            for (auto j = 0; j < 0x10000; ++j)
-            {
-                bCount[j] += threadBCount[arrayOffset + j];
-                bCount_[j >> 8] += threadBCount[arrayOffset + j] + bStarCount[arrayOffset + j];
-                aCount[j] += threadACount[arrayOffset + j];
-                aCount_[j >> 8] += threadACount[arrayOffset + j];
-            }
+            post_task_to_thread
+            (
+                threadId,
+                [&]
+                (
+                    std::int32_t symbolBegin,
+                    std::int32_t symbolEnd
+                )
+                {
+                    for (auto j = (symbolBegin << 8); j < (symbolEnd << 8); ++j)
+                    {
+                        for (auto threadId = 0; threadId < numThreads; ++threadId)
+                        {
+                            auto arrayOffset = (threadId * 0x10000);
+                            bCount[j] += threadBCount[arrayOffset + j];
+                            bCount_[j >> 8] += threadBCount[arrayOffset + j] + bStarCount[arrayOffset + j];
+                            aCount[j] += threadACount[arrayOffset + j];
+                            aCount_[j >> 8] += threadACount[arrayOffset + j];
+                        }
+                    }
+                },
+                ((0x100 * threadId) / numThreads), ((0x100 * (threadId + 1)) / numThreads)
+            );
         }
+        wait_for_all_tasks_completed();
     }
 
-    // compute bucket offsets into suffix array
-    int32_t total = 1;  // 1 for sentinel
-    int32_t bStarTotal = 0;
-    std::unique_ptr<int32_t []> totalBStarCount(new int32_t[0x10000]{});
-    std::unique_ptr<int32_t []> bStarOffset(new int32_t[numThreads * 0x10000]{});
-    std::unique_ptr<std::tuple<std::int32_t, std::int32_t, suffix_value> []> partitions(new std::tuple<std::int32_t, std::int32_t, suffix_value>[0x10000]{});
+    // compute bucket offsets into suffix array.  this is a parallel prefix sum over the buckets.
+    // each thread first totals the buckets for its range of first symbols.  the running totals at
+    // the start of each range are then used by each thread to compute the offsets within its range.
+    std::unique_ptr<suffix_index []> totalBStarCount(new suffix_index[0x10000]{});
+    std::unique_ptr<suffix_index []> bStarBucketBegin(new suffix_index[0x10000]{});
+    std::unique_ptr<suffix_index []> bStarOffset(new suffix_index[numThreads * 0x10000]{});
+    std::vector<suffix_index> rangeTotal(numThreads + 1, 0);
+    std::vector<suffix_index> rangeBStarTotal(numThreads + 1, 0);
+    std::vector<std::vector<std::tuple<suffix_index, suffix_index, suffix_value, suffix_index>>> rangePartitions(numThreads);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                std::int32_t symbolBegin,
+                std::int32_t symbolEnd,
+                std::int32_t rangeId
+            )
+            {
+                for (auto j = (symbolBegin << 8); j < (symbolEnd << 8); ++j)
+                {
+                    rangeTotal[rangeId + 1] += (bCount[j] + aCount[j]);
+                    for (auto threadId = 0; threadId < numThreads; ++threadId)
+                    {
+                        rangeTotal[rangeId + 1] += bStarCount[(threadId * 0x10000) + j];
+                        rangeBStarTotal[rangeId + 1] += bStarCount[(threadId * 0x10000) + j];
+                    }
+                }
+            },
+            ((0x100 * threadId) / numThreads), ((0x100 * (threadId + 1)) / numThreads), threadId
+        );
+    }
+    wait_for_all_tasks_completed();
 
-    auto numPartitions = 0;
-    for (int32_t i = 0; i < 0x100; ++i)
+    rangeTotal[0] = 1; // 1 for sentinel
+    for (auto rangeId = 0; rangeId < numThreads; ++rangeId)
     {
-        int32_t s = (i << 8);
-        frontBucketOffset_[i] = (suffixArrayBegin_ + total);
-        for (int32_t j = 0; j < 0x100; ++j, ++s)
-        {
-            auto partitionStartIndex = bStarTotal;
-            for (int32_t threadId = 0; threadId < numThreads; ++threadId)
+        rangeTotal[rangeId + 1] += rangeTotal[rangeId];
+        rangeBStarTotal[rangeId + 1] += rangeBStarTotal[rangeId];
+    }
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                std::int32_t symbolBegin,
+                std::int32_t symbolEnd,
+                std::int32_t rangeId
+            )
             {
-                bStarOffset[(threadId * 0x10000) + s] = bStarTotal;
-                totalBStarCount[s] += bStarCount[(threadId * 0x10000) + s];
-                bStarTotal += bStarCount[(threadId * 0x10000) + s];
-                bCount[s] += bStarCount[(threadId * 0x10000) + s];
-            }
-            total += (bCount[s] + aCount[s]);
-            backBucketOffset_[(j << 8) | i] = suffixArrayBegin_ + total;
-            if (totalBStarCount[s] > 0)
-                partitions[numPartitions++] = std::make_tuple(partitionStartIndex, totalBStarCount[s], (suffix_value)(s | j));
-        }
+                auto total = rangeTotal[rangeId];
+                auto bStarTotal = rangeBStarTotal[rangeId];
+                for (int32_t i = symbolBegin; i < symbolEnd; ++i)
+                {
+                    int32_t s = (i << 8);
+                    frontBucketOffset_[i] = (suffixArrayBegin_ + total);
+                    for (int32_t j = 0; j < 0x100; ++j, ++s)
+                    {
+                        auto partitionStartIndex = bStarTotal;
+                        bStarBucketBegin[s] = bStarTotal;
+                        for (int32_t threadId = 0; threadId < numThreads; ++threadId)
+                        {
+                            bStarOffset[(threadId * 0x10000) + s] = bStarTotal;
+                            totalBStarCount[s] += bStarCount[(threadId * 0x10000) + s];
+                            bStarTotal += bStarCount[(threadId * 0x10000) + s];
+                            bCount[s] += bStarCount[(threadId * 0x10000) + s];
+                        }
+                        total += (bCount[s] + aCount[s]);
+                        backBucketOffset_[(j << 8) | i] = suffixArrayBegin_ + total;
+                        if (totalBStarCount[s] > 0)
+                            rangePartitions[rangeId].push_back(std::make_tuple(partitionStartIndex, totalBStarCount[s], (suffix_value)s, 2));
+                    }
+                }
+            },
+            ((0x100 * threadId) / numThreads), ((0x100 * (threadId + 1)) / numThreads), threadId
+        );
     }
+    wait_for_all_tasks_completed();
+
+    suffix_index bStarTotal = rangeBStarTotal[numThreads];
+    std::vector<std::tuple<suffix_index, suffix_index, suffix_value, suffix_index>> partitions;
+    partitions.reserve(0x10000);
+    for (auto & e : rangePartitions)
+        partitions.insert(partitions.end(), e.begin(), e.end());
 
     // multi threaded two byte radix sort forms initial partitions which
     // will be fully sorted by multikey quicksort
@@ -1619,20 +2710,84 @@ void maniscalco::msufsort::first_stage_its
     }
     wait_for_all_tasks_completed();
 
+    // the B* suffixes of skewed (very large) two byte partitions are split further on their third 
+    // byte when a sample of the third bytes shows that doing so is worthwhile.  this is done within
+    // each partition so the two byte bucket layout (frontBucketOffset_ and backBucketOffset_) used
+    // by the second stage is unchanged.
+    {
+        std::vector<std::size_t> widePartitions;
+        for (std::size_t i = 0; i < partitions.size(); ++i)
+            if ((std::get<1>(partitions[i]) >= (suffix_index)min_radix_partition_size) && (std::get<1>(partitions[i]) >= (bStarTotal >> three_byte_radix_partition_shift)))
+                widePartitions.push_back(i);
+        std::vector<std::vector<suffix_index>> thirdByteCount(widePartitions.size());
+        for (auto threadId = 0; threadId < numThreads; ++threadId)
+        {
+            post_task_to_thread
+            (
+                threadId,
+                [&]
+                (
+                    std::int32_t threadId
+                )
+                {
+                    for (auto i = (std::size_t)threadId; i < widePartitions.size(); i += numThreads)
+                    {
+                        auto const & partition = partitions[widePartitions[i]];
+                        auto partitionBegin = suffixArrayBegin_ + std::get<0>(partition);
+                        auto partitionEnd = partitionBegin + std::get<1>(partition);
+                        if (count_sampled_distinct_digits<std::uint8_t>(partitionBegin, partitionEnd, inputBegin_ + 2) >= min_radix_distinct_digits)
+                            thirdByteCount[i] = radix_partition<std::uint8_t>(partitionBegin, partitionEnd, inputBegin_ + 2);
+                    }
+                },
+                threadId
+            );
+        }
+        wait_for_all_tasks_completed();
+
+        for (std::size_t i = 0; i < widePartitions.size(); ++i)
+        {
+            auto partition = partitions[widePartitions[i]];
+            auto partitionBegin = std::get<0>(partition);
+            for (std::size_t j = 0; j < thirdByteCount[i].size(); ++j)
+            {
+                auto size = thirdByteCount[i][j];
+                if (size == 0)
+                    continue;
+                auto threeBytePartition = std::make_tuple(partitionBegin, size, (suffix_value)((std::get<2>(partition) << 8) | j), 3);
+                if (partitionBegin == std::get<0>(partition))
+                    partitions[widePartitions[i]] = threeBytePartition;
+                else
+                    partitions.push_back(threeBytePartition);
+                partitionBegin += size;
+            }
+        }
+    }
+    std::int32_t numPartitions = (std::int32_t)partitions.size();
+
     auto finish = std::chrono::system_clock::now();
     #ifdef VERBOSE
-        std::cout << "direct sort initial 16 bit sort time: " << std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count() << " ms " << std::endl;
+        std::cout << "direct sort initial radix sort time: " << std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count() << " ms " << std::endl;
     #endif
     start = std::chrono::system_clock::now();
     
     // multikey quicksort on B* parititions
+    directSortBudget_ = ((std::int64_t)inputSize_ * direct_sort_budget_per_byte);
     std::atomic<std::int32_t> partitionCount(numPartitions);
     std::vector<tandem_repeat_info> tandemRepeatStack[numThreads];
     // sort the partitions by size to ensure that the largest partitinos are not sorted last.
     // this prevents the case where the last thread is assigned a large partition while all other
     // threads exit due to no more partitions to sort.
-    std::sort(partitions.get(), partitions.get() + partitionCount.load(), [](std::tuple<std::int32_t, std::int32_t, suffix_value> const & a, std::tuple<std::int32_t, std::int32_t, suffix_value> const & b) -> bool{return (std::get<1>(a) < std::get<1>(b));});
-
+    std::sort(partitions.begin(), partitions.end(), [](std::tuple<suffix_index, suffix_index, suffix_value, suffix_index> const & a, std::tuple<suffix_index, suffix_index, suffix_value, suffix_index> const & b) -> bool{return (std::get<1>(a) < std::get<1>(b));});
+
+    // each thread sorts the sub partitions that it produces unless they are large, in which case
+    // they are pushed to that thread's deque.  a thread without work takes from its own deque first,
+    // then takes the next two byte partition and, failing that, steals from the deques of other threads.
+    // the sort is complete once no partition tasks remain unfinished.
+    std::unique_ptr<partition_task_deque<suffix_value> []> partitionTaskDeques(new partition_task_deque<suffix_value>[numThreads]);
+    std::unique_ptr<cached_key<suffix_value> []> keyCaches(key_cache_enabled ? new cached_key<suffix_value>[numThreads * (key_cache_size + 2)] : nullptr);
+    unfinishedPartitionTasks_ = numPartitions;
+    queuedPartitionTasks_ = 0;
+    idlePartitionThreads_ = 0;
     for (auto threadId = 0; threadId < numThreads; ++threadId)
     {
         tandemRepeatStack[threadId].reserve(1024);
@@ -1641,29 +2796,128 @@ void maniscalco::msufsort::first_stage_its
             threadId,
             [&]
             (
-                std::vector<tandem_repeat_info> & tandemRepeatStack
+                std::vector<tandem_repeat_info> & tandemRepeatStack,
+                std::int32_t threadId
             )
             {
-                while (true)
+                auto partitionTaskDeque = (numThreads > 1) ? &partitionTaskDeques[threadId] : nullptr;
+                partition_task<suffix_value> partitionTask;
+                while ((!direct_sort_abandoned()) && (unfinishedPartitionTasks_.load() > 0))
                 {
-                    std::int32_t partitionIndex = --partitionCount;
-                    if (partitionIndex < 0)
-                        break;
-                    auto const & partition = partitions[partitionIndex];
-                    multikey_quicksort(suffixArrayBegin_ + std::get<0>(partition), suffixArrayBegin_ + std::get<0>(partition) + 
-                            std::get<1>(partition), 2, 0, {0, std::get<2>(partition)}, tandemRepeatStack);
+                    auto havePartitionTask = ((partitionTaskDeque != nullptr) && (partitionTaskDeque->pop(partitionTask)));
+                    if (havePartitionTask)
+                        --queuedPartitionTasks_;
+                    if (!havePartitionTask)
+                    {
+                        std::int32_t partitionIndex = (partitionCount.load() > 0) ? --partitionCount : -1;
+                        if (partitionIndex >= 0)
+                        {
+                            auto const & partition = partitions[partitionIndex];
+                            partitionTask = {suffixArrayBegin_ + std::get<0>(partition), suffixArrayBegin_ + std::get<0>(partition) + 
+                                    std::get<1>(partition), std::get<3>(partition), 0, {0, std::get<2>(partition)}};
+                            havePartitionTask = true;
+                        }
+                    }
+                    for (auto i = 1; ((!havePartitionTask) && (i < numThreads)); ++i)
+                    {
+                        havePartitionTask = partitionTaskDeques[(threadId + i) % numThreads].steal(partitionTask);
+                        if (havePartitionTask)
+                            --queuedPartitionTasks_;
+                    }
+                    if (!havePartitionTask)
+                    {
+                        // other threads are still sorting and might yet share some of their work.  park until 
+                        // they do or until the sort is complete.
+                        ++idlePartitionThreads_;
+                        {
+                            std::unique_lock<std::mutex> lock(partitionTaskMutex_);
+                            partitionTaskCondition_.wait(lock, [&](){return ((queuedPartitionTasks_.load() > 0) || 
+                                    (unfinishedPartitionTasks_.load() == 0) || (direct_sort_abandoned()));});
+                        }
+                        --idlePartitionThreads_;
+                        continue;
+                    }
+                    multikey_quicksort(partitionTask.partitionBegin_, partitionTask.partitionEnd_, partitionTask.matchLength_, 
+                            partitionTask.startingPattern_, partitionTask.endingPattern_, tandemRepeatStack, partitionTaskDeque, 
+                            key_cache_enabled ? (keyCaches.get() + (threadId * (key_cache_size + 2))) : nullptr);
+                    if (((--unfinishedPartitionTasks_ == 0) || (direct_sort_abandoned())) && (idlePartitionThreads_.load() > 0))
+                    {
+                        // wake the parked threads so that they can exit
+                        {
+                            std::lock_guard<std::mutex> lock(partitionTaskMutex_);
+                        }
+                        partitionTaskCondition_.notify_all();
+                    }
                 }
             },
-            std::ref(tandemRepeatStack[threadId])
+            std::ref(tandemRepeatStack[threadId]), threadId
         );
     }
     wait_for_all_tasks_completed();
 
-    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    if (direct_sort_abandoned())
     {
-        post_task_to_thread
-        (
-            threadId,
+        // the B* partitions are too repetitive for the direct sort to complete in linear time.
+        // discard the partial sort and use induced sorting instead.
+        #ifdef VERBOSE
+            std::cout << "direct sort abandoned - using induced sort" << std::endl;
+        #endif
+        for (auto & e : tandemRepeatStack)
+            e.clear();
+        induced_sort_b_star_suffixes();
+    }
+    else if (numThreads > 1)
+    {
+        // tandem repeats must be completed innermost first which each thread's stack guarantees only 
+        // for the partitions that it sorted.  with partitions shared between threads, regroup the tandem 
+        // repeats so that each group of nested tandem repeats is completed by a single thread with the 
+        // innermost (smallest) at the top of the stack.  disjoint groups are completed in parallel.
+        std::vector<tandem_repeat_info> tandemRepeats;
+        for (auto & e : tandemRepeatStack)
+        {
+            tandemRepeats.insert(tandemRepeats.end(), e.begin(), e.end());
+            e.clear();
+        }
+        std::sort(tandemRepeats.begin(), tandemRepeats.end(), [](tandem_repeat_info const & a, tandem_repeat_info const & b) -> bool
+                {return ((a.partitionBegin_ != b.partitionBegin_) ? (a.partitionBegin_ < b.partitionBegin_) : (a.partitionEnd_ > b.partitionEnd_));});
+        std::vector<std::int64_t> threadWorkload(numThreads, 0);
+        for (auto groupBegin = tandemRepeats.begin(); groupBegin != tandemRepeats.end(); )
+        {
+            auto groupEnd = groupBegin + 1;
+            auto partitionEnd = groupBegin->partitionEnd_;
+            while ((groupEnd != tandemRepeats.end()) && (groupEnd->partitionBegin_ < partitionEnd))
+                partitionEnd = std::max(partitionEnd, (groupEnd++)->partitionEnd_);
+            std::sort(groupBegin, groupEnd, [](tandem_repeat_info const & a, tandem_repeat_info const & b) -> bool
+                    {return (std::distance(a.partitionBegin_, a.partitionEnd_) > std::distance(b.partitionBegin_, b.partitionEnd_));});
+            auto threadId = std::distance(threadWorkload.begin(), std::min_element(threadWorkload.begin(), threadWorkload.end()));
+            threadWorkload[threadId] += std::distance(groupBegin->partitionBegin_, partitionEnd);
+            tandemRepeatStack[threadId].insert(tandemRepeatStack[threadId].end(), groupBegin, groupEnd);
+            groupBegin = groupEnd;
+        }
+    }
+
+    // the ISA half of the suffix array is only read to complete tandem repeats.
+    // clear it, in parallel, only when there are tandem repeats to complete.
+    if (std::any_of(tandemRepeatStack, tandemRepeatStack + numThreads, [](std::vector<tandem_repeat_info> const & e){return !e.empty();}))
+    {
+        auto numEntriesPerThread = ((std::distance(inverseSuffixArrayBegin_, inverseSuffixArrayEnd_) + numThreads - 1) / numThreads);
+        auto inverseSuffixArrayCurrent = inverseSuffixArrayBegin_;
+        for (auto threadId = 0; threadId < numThreads; ++threadId)
+        {
+            auto inverseSuffixArrayEnd = inverseSuffixArrayCurrent + numEntriesPerThread;
+            if (inverseSuffixArrayEnd > inverseSuffixArrayEnd_)
+                inverseSuffixArrayEnd = inverseSuffixArrayEnd_;
+            post_task_to_thread(threadId, [](suffix_index * begin, suffix_index * end){std::fill(begin, end, 0);}, inverseSuffixArrayCurrent, inverseSuffixArrayEnd);
+            inverseSuffixArrayCurrent = inverseSuffixArrayEnd;
+        }
+        wait_for_all_tasks_completed();
+    }
+
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
             [&]
             (
                 std::vector<tandem_repeat_info> & tandemRepeatStack
@@ -1674,173 +2928,1540 @@ void maniscalco::msufsort::first_stage_its
             std::ref(tandemRepeatStack[threadId])
         );
     }
-    wait_for_all_tasks_completed();
+    wait_for_all_tasks_completed();
+
+    // spread b* to their final locations in suffix array.  the b* are compacted at the front of
+    // the suffix array and each bucket moves towards the back.  the spread is done in rounds, from the
+    // last bucket to the first.  each round spreads, in parallel, all buckets whose final locations
+    // lie beyond the b* which remain to be spread.  a bucket whose final location overlaps its own
+    // b* is spread on its own.
+    auto spreadBuckets = [&]
+            (
+                std::int32_t bucketsBegin,
+                std::int32_t bucketsEnd
+            )
+            {
+                for (auto i = bucketsEnd - 1; i >= bucketsBegin; --i)
+                {
+                    if (bCount[i] || aCount[i])
+                    {
+                        auto destination = backBucketOffset_[((i & 0xff) << 8) | (i >> 8)] - bCount[i];
+                        auto source = suffixArrayBegin_ + bStarBucketBegin[i];
+                        for (auto j = totalBStarCount[i] - 1; j >= 0; --j)
+                            destination[j] = source[j];
+                        for (auto j = totalBStarCount[i]; j < bCount[i]; ++j)
+                            destination[j] = suffix_is_unsorted_b_type;
+                        destination -= aCount[i];
+                        for (auto j = 0; j < aCount[i]; ++j)
+                            destination[j] = preceding_suffix_is_type_a_flag;
+                    }
+                }
+            };
+    std::int32_t bucketsEnd = 0x10000;
+    while (bucketsEnd > 0)
+    {
+        auto unspreadBStarEnd = (bucketsEnd == 0x10000) ? bStarTotal : bStarBucketBegin[bucketsEnd];
+        auto bucketsBegin = bucketsEnd;
+        while ((bucketsBegin > 0) && ((backBucketOffset_[(((bucketsBegin - 1) & 0xff) << 8) | ((bucketsBegin - 1) >> 8)] -
+                bCount[bucketsBegin - 1] - aCount[bucketsBegin - 1]) >= (suffixArrayBegin_ + unspreadBStarEnd)))
+            --bucketsBegin;
+        if (bucketsBegin == bucketsEnd)
+        {
+            spreadBuckets(--bucketsBegin, bucketsEnd);
+        }
+        else
+        {
+            auto numBucketsPerThread = (((bucketsEnd - bucketsBegin) + numThreads - 1) / numThreads);
+            for (auto threadId = 0; threadId < numThreads; ++threadId)
+            {
+                auto threadBucketsBegin = std::min(bucketsEnd, bucketsBegin + (threadId * numBucketsPerThread));
+                auto threadBucketsEnd = std::min(bucketsEnd, threadBucketsBegin + numBucketsPerThread);
+                post_task_to_thread(threadId, spreadBuckets, threadBucketsBegin, threadBucketsEnd);
+            }
+            wait_for_all_tasks_completed();
+        }
+        bucketsEnd = bucketsBegin;
+    }
+    suffixArrayBegin_[0] = (inputSize_ | preceding_suffix_is_type_a_flag); // sa[0] = sentinel
+
+    finish = std::chrono::system_clock::now();
+    #ifdef VERBOSE
+        std::cout << "direct sort time: " << std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count() << " ms " << std::endl;
+    #endif
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::initialize
+(
+    // private:
+    // prepares the state for sorting the input into the provided
+    // suffix array storage of (inputSize + 1) entries.
+    // the storage need not be initialized.
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    suffix_index * suffixArray
+)
+{
+    inputBegin_ = inputBegin;
+    inputEnd_ = inputEnd;
+    inputSize_ = std::distance(inputBegin_, inputEnd_);
+    // copy of the end of the input (followed by zeros) from which get_value reads 
+    // keys of any supported width which would extend past the end of the input
+    for (auto & e : copyEnd_)
+        e = 0x00;
+    auto source = inputEnd_ - sizeof(max_suffix_value);
+    auto dest = copyEnd_;
+    if (source < inputBegin_)
+    {
+        auto n = std::distance(source, inputBegin);
+        source += n;
+        dest += n;
+    }
+    std::copy(source, inputEnd_, dest);
+    // the symbol counts are accumulated by first_stage_its() and must be cleared 
+    // when an instance is reused
+    std::fill(std::begin(aCount_), std::end(aCount_), 0);
+    std::fill(std::begin(bCount_), std::end(bCount_), 0);
+    auto suffixArraySize = (inputSize_ + 1);
+    suffixArrayBegin_ = suffixArray;
+    suffixArrayEnd_ = suffixArrayBegin_ + suffixArraySize;
+    inverseSuffixArrayBegin_ = (suffixArrayBegin_ + ((inputSize_ + 1) >> 1));
+    inverseSuffixArrayEnd_ = suffixArrayEnd_;
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::make_suffix_array
+(
+    // public:
+    // computes the suffix array for the input data
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd
+) -> suffix_array
+{
+    suffix_array suffixArray(std::distance(inputBegin, inputEnd) + 1);
+    apply_allocation_policy(suffixArray.data(), suffixArray.size() * sizeof(suffix_index));
+    make_suffix_array(inputBegin, inputEnd, suffixArray.data());
+    return suffixArray;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::make_suffix_array
+(
+    // public:
+    // computes the suffix array for the input data into caller provided
+    // storage which must hold (inputSize + 1) suffix indexes
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    suffix_index * suffixArray
+)
+{
+    if (inputBegin == inputEnd)
+    {
+        suffixArray[0] = 0; // only the empty suffix
+        return;
+    }
+    initialize(inputBegin, inputEnd, suffixArray);
+    first_stage_its();
+    second_stage_its();
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::make_suffix_array
+(
+    // public:
+    // computes the suffix array for the input data into storage
+    // obtained from the provided memory resource
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    std::pmr::memory_resource * memoryResource
+) -> pmr_suffix_array
+{
+    pmr_suffix_array suffixArray(std::distance(inputBegin, inputEnd) + 1, memoryResource);
+    make_suffix_array(inputBegin, inputEnd, suffixArray.data());
+    return suffixArray;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::make_suffix_array
+(
+    // public:
+    // computes the suffix array out of core and writes it to the output stream.  first ranks a 
+    // difference cover sample of the suffixes, using the densest cover which fits the budget.  the 
+    // rest of the budget holds groups of suffixes which are sorted by their bytes up to the cover 
+    // size and then by their sample ranks.  each group costs two sequential passes over the input.
+    // all output is written sequentially.
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    std::ostream & outputStream,
+    std::size_t memoryBudget,
+    suffix_array_format suffixArrayFormat
+)
+{
+    inputBegin_ = inputBegin;
+    inputEnd_ = inputEnd;
+    inputSize_ = std::distance(inputBegin, inputEnd);
+
+    // the densest cover whose ranking fits the budget and whose ranks leave at least three
+    // quarters of the budget for the groups
+    auto coverRoot = min_out_of_core_cover_root;
+    std::size_t capacity = 0;
+    for (; ((inputSize_ > 0) && (coverRoot <= max_out_of_core_cover_root)); coverRoot <<= 1)
+    {
+        auto sampleSize = get_out_of_core_sample_size(inputSize_, coverRoot);
+        auto rankSize = ((sampleSize + (coverRoot << 1)) * sizeof(suffix_index));
+        auto rankingSize = (rankSize + (sampleSize * (sizeof(out_of_core_entry) + (2 * sizeof(suffix_index)))));
+        if ((rankingSize <= memoryBudget) && (rankSize <= (memoryBudget >> 2)))
+        {
+            capacity = ((memoryBudget - rankSize) / sizeof(out_of_core_entry));
+            if (capacity >= 2)
+                break;
+        }
+    }
+    if (coverRoot > max_out_of_core_cover_root)
+        throw std::invalid_argument("msufsort: memory budget too small for the out of core suffix array");
+
+    suffix_index sentinel = inputSize_; // the empty suffix sorts first
+    if (suffixArrayFormat == packed_suffix_array_format)
+    {
+        std::uint8_t packedSentinel[packed_suffix_index_size];
+        pack_suffix_indexes(&sentinel, &sentinel + 1, packedSentinel);
+        outputStream.write((char const *)packedSentinel, sizeof(packedSentinel));
+    }
+    else
+    {
+        outputStream.write((char const *)&sentinel, sizeof(sentinel));
+    }
+    if (inputSize_ > 0)
+    {
+        out_of_core_sample sample;
+        make_out_of_core_sample(coverRoot, sample);
+        std::vector<out_of_core_entry> group;
+        make_suffix_array_out_of_core(0, 0, capacity, outputStream, suffixArrayFormat, group, sample);
+    }
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::make_packed_suffix_array
+(
+    // public:
+    // computes the suffix array for the input data and returns it packed.  the suffix array is
+    // computed into the storage of the packed suffix array and then packed in place, which leaves
+    // a peak of one native suffix array (8n) rather than a native plus a packed one (13n).  
+    // the packed indexes are written over indexes which have already been read.  after the first
+    // (on this thread) each round packs, in parallel, as many indexes as fit in the space freed by 
+    // the rounds before it.
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd
+) -> packed_suffix_array
+{
+    if (sizeof(suffix_index) <= packed_suffix_index_size)
+        throw std::invalid_argument("msufsort: packed suffix arrays require 64 bit suffix indexes");
+    std::size_t size = (std::distance(inputBegin, inputEnd) + 1);
+    packed_suffix_array packedSuffixArray(size, size * sizeof(suffix_index));
+    auto suffixArray = (suffix_index *)packedSuffixArray.data();
+    apply_allocation_policy(suffixArray, size * sizeof(suffix_index));
+    make_suffix_array(inputBegin, inputEnd, suffixArray);
+
+    static std::size_t constexpr min_pack_round_size = (1 << 16);
+    auto numThreads = (std::int32_t)(numWorkerThreads_ + 1);
+    std::size_t packed = std::min(size, min_pack_round_size);
+    pack_suffix_indexes(suffixArray, suffixArray + packed, packedSuffixArray.data());
+    while (packed < size)
+    {
+        // packing indexes [packed, packed + roundSize) writes below byte (packed * sizeof(suffix_index)),
+        // the first byte not yet read, when (roundSize * packed_suffix_index_size) is at most the 
+        // (packed * (sizeof(suffix_index) - packed_suffix_index_size)) bytes freed so far.
+        auto roundSize = std::min(size - packed, (packed * (sizeof(suffix_index) - packed_suffix_index_size)) / packed_suffix_index_size);
+        auto suffixesPerThread = ((roundSize + numThreads - 1) / numThreads);
+        for (auto threadId = 0; threadId < numThreads; ++threadId)
+        {
+            auto begin = std::min(packed + roundSize, packed + (threadId * suffixesPerThread));
+            auto end = std::min(packed + roundSize, begin + suffixesPerThread);
+            post_task_to_thread(threadId, &pack_suffix_indexes, suffixArray + begin, suffixArray + end, 
+                    packedSuffixArray.data() + (begin * packed_suffix_index_size));
+        }
+        wait_for_all_tasks_completed();
+        packed += roundSize;
+    }
+    packedSuffixArray.shrink_to_fit();
+    return packedSuffixArray;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::make_lcp_array
+(
+    // public:
+    // computes the lcp array for the suffix array of the input data using the permuted lcp
+    // (phi) method.  the total work is linear and the phi array of inputSize suffix indexes is
+    // the only extra memory used.  the lcp array may overwrite the suffix array.
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    suffix_index const * suffixArray,
+    suffix_index * lcpArray
+)
+{
+    suffix_index inputSize = std::distance(inputBegin, inputEnd);
+    if (inputSize == 0)
+    {
+        lcpArray[0] = 0;
+        return;
+    }
+    auto phiSize = (inputSize * sizeof(suffix_index));
+    auto phi = (suffix_index *)allocate_pages(phiSize);
+    auto numThreads = (std::int32_t)(numWorkerThreads_ + 1);
+    auto suffixesPerThread = ((inputSize + numThreads - 1) / numThreads);
+
+    // phi maps each suffix to the suffix which precedes it in the suffix array.  suffixArray[0] is
+    // the empty suffix which precedes all others so it maps to inputSize.
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                suffix_index begin,
+                suffix_index end
+            )
+            {
+                for (auto i = begin; i < end; ++i)
+                    phi[suffixArray[i + 1]] = suffixArray[i];
+            },
+            std::min(inputSize, threadId * suffixesPerThread), std::min(inputSize, (threadId + 1) * suffixesPerThread)
+        );
+    }
+    wait_for_all_tasks_completed();
+
+    // permuted lcp in input order, replacing phi.  plcp[i] >= (plcp[i - 1] - 1) so each thread carries
+    // the match length forward through its range of the input and only the first suffix of each range
+    // is matched from scratch.
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                suffix_index begin,
+                suffix_index end
+            )
+            {
+                suffix_index matchLength = 0;
+                for (auto i = begin; i < end; ++i)
+                {
+                    auto j = phi[i];
+                    auto maxLength = (inputSize - std::max(i, j));
+                    matchLength += match_length(inputBegin + i + matchLength, inputBegin + j + matchLength, maxLength - matchLength);
+                    phi[i] = matchLength;
+                    if (matchLength > 0)
+                        --matchLength;
+                }
+            },
+            std::min(inputSize, threadId * suffixesPerThread), std::min(inputSize, (threadId + 1) * suffixesPerThread)
+        );
+    }
+    wait_for_all_tasks_completed();
+
+    // permute to suffix array order.  each suffix index is read before its lcp overwrites it.
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                suffix_index begin,
+                suffix_index end
+            )
+            {
+                for (auto i = begin; i < end; ++i)
+                    lcpArray[i + 1] = phi[suffixArray[i + 1]];
+            },
+            std::min(inputSize, threadId * suffixesPerThread), std::min(inputSize, (threadId + 1) * suffixesPerThread)
+        );
+    }
+    wait_for_all_tasks_completed();
+    lcpArray[0] = 0;
+    release_pages(phi, phiSize);
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::make_lcp_array
+(
+    // public:
+    // as above but returns the lcp array
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    suffix_index const * suffixArray
+) -> suffix_array
+{
+    suffix_array lcpArray(std::distance(inputBegin, inputEnd) + 1);
+    make_lcp_array(inputBegin, inputEnd, suffixArray, lcpArray.data());
+    return lcpArray;
+}
+
+
+//==============================================================================
+inline std::uint64_t maniscalco::msufsort::get_padded_prefix
+(
+    // private:
+    // returns the first eight bytes of the suffix as a big endian value padded with zeros beyond 
+    // the end of the input.  the order of these prefixes never contradicts the order of the suffixes.
+    suffix_index suffixIndex
+) const
+{
+    std::uint64_t prefix = 0;
+    if ((suffixIndex + (suffix_index)sizeof(prefix)) <= inputSize_)
+    {
+        std::memcpy(&prefix, inputBegin_ + suffixIndex, sizeof(prefix));
+        return endian_swap<host_order_type, big_endian_type>(prefix);
+    }
+    for (auto i = 0; i < (int32_t)sizeof(prefix); ++i)
+        prefix = ((prefix << 8) | (((suffixIndex + i) < inputSize_) ? inputBegin_[suffixIndex + i] : 0));
+    return prefix;
+}
+
+
+//==============================================================================
+std::size_t maniscalco::msufsort::get_out_of_core_sample_size
+(
+    // private:
+    // returns the number of positions of an input of inputSize bytes which are in the 
+    // difference cover sample with the given cover root
+    suffix_index inputSize,
+    suffix_index coverRoot
+)
+{
+    auto coverSize = (coverRoot * coverRoot);
+    std::size_t sampleSize = 0;
+    for (suffix_index residue = 0; ((residue < coverSize) && (residue < inputSize)); residue += ((residue < coverRoot) ? 1 : coverRoot))
+        sampleSize += (((inputSize - 1 - residue) / coverSize) + 1);
+    return sampleSize;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::make_out_of_core_sample
+(
+    // private:
+    // ranks the suffixes at the positions of the difference cover sample.  the sample suffixes are 
+    // sorted and named by their first (coverSize + 8) bytes.  the names of the positions of each 
+    // covered residue, in input order, are concatenated into a reduced text.  a sample suffix which
+    // ends within its first (coverSize + 8) bytes has a unique name so no two suffixes of the reduced
+    // text are compared beyond the names of their residues, and the order of the reduced suffixes is
+    // the order of the sample suffixes.  the reduced text is sorted by induced sorting unless its
+    // names are already unique.  rank zero is left for the empty suffix.
+    suffix_index coverRoot,
+    out_of_core_sample & sample
+)
+{
+    auto coverSize = (coverRoot * coverRoot);
+    sample.coverRoot_ = coverRoot;
+    sample.coverSize_ = coverSize;
+    // the covered residues, in order, are [0, coverRoot] and then (2 * coverRoot), (3 * coverRoot) ...
+    auto get_cover_slot = [&](suffix_index residue){return ((residue <= coverRoot) ? residue : (coverRoot - 1 + (residue / coverRoot)));};
+    sample.residueBegin_.assign(coverRoot << 1, 0);
+    sample.rank_.clear();
+    suffix_index sampleSize = 0;
+    for (suffix_index residue = 0; ((residue < coverSize) && (residue < inputSize_)); residue += ((residue < coverRoot) ? 1 : coverRoot))
+    {
+        sample.residueBegin_[get_cover_slot(residue)] = sampleSize;
+        sampleSize += (((inputSize_ - 1 - residue) / coverSize) + 1);
+    }
+
+    std::vector<out_of_core_entry> sampleSuffixes;
+    sampleSuffixes.reserve(sampleSize);
+    for (suffix_index residue = 0; ((residue < coverSize) && (residue < inputSize_)); residue += ((residue < coverRoot) ? 1 : coverRoot))
+        for (auto suffixIndex = residue; suffixIndex < inputSize_; suffixIndex += coverSize)
+            sampleSuffixes.push_back({get_padded_prefix(suffixIndex), suffixIndex});
+    sort_out_of_core_entries(sampleSuffixes.data(), sampleSuffixes.data() + sampleSize, sample);
+
+    std::vector<suffix_index> reducedText(sampleSize);
+    suffix_index name = 0;
+    for (suffix_index i = 0; i < sampleSize; ++i)
+    {
+        auto suffixIndex = sampleSuffixes[i].index_;
+        if ((i > 0) && (!out_of_core_prefixes_match(sampleSuffixes[i - 1].index_, suffixIndex, coverSize + (suffix_index)sizeof(std::uint64_t))))
+            ++name;
+        reducedText[sample.residueBegin_[get_cover_slot(suffixIndex % coverSize)] + (suffixIndex / coverSize)] = name;
+    }
+    std::vector<out_of_core_entry>().swap(sampleSuffixes);
+
+    if ((name + 1) == sampleSize)
+    {
+        for (auto & rank : reducedText)
+            ++rank;
+    }
+    else
+    {
+        std::vector<suffix_index> suffixArray(sampleSize + 1);
+        induced_sort<suffix_index>(reducedText.data(), suffixArray.data(), sampleSize, name + 1);
+        for (suffix_index i = 1; i <= sampleSize; ++i)
+            reducedText[suffixArray[i]] = i;
+    }
+    sample.rank_ = std::move(reducedText);
+}
+
+
+//==============================================================================
+inline auto maniscalco::msufsort::get_out_of_core_rank
+(
+    // private:
+    // returns the rank of the suffix at a position of the sample.  the empty suffix ranks first.
+    suffix_index suffixIndex,
+    out_of_core_sample const & sample
+) const -> suffix_index
+{
+    if (suffixIndex == inputSize_)
+        return 0;
+    auto residue = (suffixIndex & (sample.coverSize_ - 1));
+    auto coverSlot = ((residue <= sample.coverRoot_) ? residue : (sample.coverRoot_ - 1 + (residue / sample.coverRoot_)));
+    return sample.rank_[sample.residueBegin_[coverSlot] + (suffixIndex / sample.coverSize_)];
+}
+
+
+//==============================================================================
+bool maniscalco::msufsort::compare_out_of_core_suffixes
+(
+    // private:
+    // returns true if suffix 'a' sorts before suffix 'b'.  the suffixes share their first commonPrefix
+    // bytes.  finds the offset at which both suffixes are in the sample, compares the bytes which
+    // precede it and then the ranks of the sample suffixes at that offset.  for a difference of
+    // (q * coverRoot) + s between the two positions the residues (coverRoot - s) and 
+    // ((q + 1) * coverRoot) are both covered.
+    suffix_index a,
+    suffix_index b,
+    suffix_index commonPrefix,
+    out_of_core_sample const & sample
+) const
+{
+    auto coverMask = (sample.coverSize_ - 1); // the cover root is a power of two
+    auto difference = ((b - a) & coverMask);
+    auto offset = (((sample.coverRoot_ - (difference & (sample.coverRoot_ - 1))) - (a & coverMask)) & coverMask);
+    if (commonPrefix < offset)
+    {
+        auto length = std::min({offset, inputSize_ - a, inputSize_ - b});
+        if (commonPrefix < length)
+        {
+            auto result = std::memcmp(inputBegin_ + a + commonPrefix, inputBegin_ + b + commonPrefix, length - commonPrefix);
+            if (result != 0)
+                return (result < 0);
+        }
+        if (length < offset)
+            return (a > b); // the shorter suffix is a prefix of the other
+    }
+    return (get_out_of_core_rank(a + offset, sample) < get_out_of_core_rank(b + offset, sample));
+}
+
+
+//==============================================================================
+bool maniscalco::msufsort::out_of_core_prefixes_match
+(
+    // private:
+    // returns true if suffixes 'a' and 'b' are both at least 'length' bytes long and their 
+    // first 'length' bytes match.  'length' is a multiple of eight.
+    suffix_index a,
+    suffix_index b,
+    suffix_index length
+) const
+{
+    for (suffix_index depth = 0; depth < length; depth += (suffix_index)sizeof(std::uint64_t))
+        if ((std::min(inputSize_ - a, inputSize_ - b) < (depth + (suffix_index)sizeof(std::uint64_t))) ||
+                (get_padded_prefix(a + depth) != get_padded_prefix(b + depth)))
+            return false;
+    return true;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::sort_out_of_core_entries
+(
+    // private:
+    // multikey quicksort of the suffixes eight bytes at a time.  the prefix of each entry holds the 
+    // eight bytes at the current depth.  a suffix which ends within those bytes sorts before the 
+    // longer suffixes with the same bytes.  once the sample is ranked suffixes which share their 
+    // first max_multikey_depth bytes are sorted by compare_out_of_core_suffixes.  while it is being 
+    // ranked suffixes which share more than their first coverSize bytes are left as they are.
+    // the bytes compared per suffix are therefore bounded by the cover size regardless of the input.
+    out_of_core_entry * begin,
+    out_of_core_entry * end,
+    out_of_core_sample const & sample
+) const
+{
+    static std::ptrdiff_t constexpr min_partition_size = 16;
+    static suffix_index constexpr max_multikey_depth = 64; // deeper ties are ordered by comparisons once the sample is ranked
+    struct partition
+    {
+        out_of_core_entry * begin_;
+        out_of_core_entry * end_;
+        suffix_index        depth_;
+    };
+    std::vector<partition> stack;
+    stack.push_back({begin, end, 0});
+    while (!stack.empty())
+    {
+        auto current = stack.back();
+        stack.pop_back();
+        auto depth = current.depth_;
+        if ((depth > sample.coverSize_) || ((depth >= max_multikey_depth) && (!sample.rank_.empty())))
+        {
+            if (!sample.rank_.empty())
+                std::sort(current.begin_, current.end_, [&](out_of_core_entry const & a, out_of_core_entry const & b) -> bool
+                        {
+                            return compare_out_of_core_suffixes(a.index_, b.index_, depth, sample);
+                        });
+            continue;
+        }
+        auto length = [&](out_of_core_entry const & entry){return std::min(inputSize_ - entry.index_ - depth, (suffix_index)sizeof(std::uint64_t));};
+        auto less = [&](out_of_core_entry const & a, out_of_core_entry const & b) -> bool
+                {
+                    return ((a.prefix_ != b.prefix_) ? (a.prefix_ < b.prefix_) : (length(a) < length(b)));
+                };
+        // a run of more than one suffix with equal keys is a run of suffixes which share the next 
+        // eight bytes.  it continues at the depth which follows.
+        auto push_run = [&](out_of_core_entry * runBegin, out_of_core_entry * runEnd)
+                {
+                    if ((runEnd - runBegin) < 2)
+                        return;
+                    auto nextDepth = (depth + (suffix_index)sizeof(std::uint64_t));
+                    if (nextDepth <= sample.coverSize_)
+                        for (auto entry = runBegin; entry < runEnd; ++entry)
+                            entry->prefix_ = get_padded_prefix(entry->index_ + nextDepth);
+                    stack.push_back({runBegin, runEnd, nextDepth});
+                };
+        if ((current.end_ - current.begin_) < min_partition_size)
+        {
+            std::sort(current.begin_, current.end_, less);
+            for (auto runBegin = current.begin_; runBegin < current.end_; )
+            {
+                auto runEnd = runBegin + 1;
+                while ((runEnd < current.end_) && (!less(*runBegin, *runEnd)))
+                    ++runEnd;
+                push_run(runBegin, runEnd);
+                runBegin = runEnd;
+            }
+            continue;
+        }
+        // three way partition about the median of three
+        auto first = *current.begin_;
+        auto middle = current.begin_[(current.end_ - current.begin_) >> 1];
+        auto last = current.end_[-1];
+        auto pivot = (less(first, middle)) ? ((less(middle, last)) ? middle : ((less(first, last)) ? last : first)) :
+                ((less(first, last)) ? first : ((less(middle, last)) ? last : middle));
+        auto lessEnd = std::partition(current.begin_, current.end_, [&](out_of_core_entry const & entry){return less(entry, pivot);});
+        auto equalEnd = std::partition(lessEnd, current.end_, [&](out_of_core_entry const & entry){return !less(pivot, entry);});
+        if ((lessEnd - current.begin_) > 1)
+            stack.push_back({current.begin_, lessEnd, depth});
+        if ((current.end_ - equalEnd) > 1)
+            stack.push_back({equalEnd, current.end_, depth});
+        push_run(lessEnd, equalEnd);
+    }
+}
+
+
+//==============================================================================
+template <typename classify_function, typename split_function>
+void maniscalco::msufsort::make_suffix_array_out_of_core
+(
+    // private:
+    // sorts the suffixes which 'classify' places in buckets [0, numBuckets) and writes them to the 
+    // output stream.  the buckets must be in suffix order.  the suffixes are counted by bucket and 
+    // consecutive buckets are grouped into groups of at most 'capacity' suffixes.  each group is 
+    // gathered from the input, bucket by bucket, and then each bucket is sorted.  a bucket which 
+    // alone exceeds the capacity is passed to 'splitBucket' instead.
+    classify_function classify,
+    std::int32_t numBuckets,
+    split_function splitBucket,
+    std::size_t capacity,
+    std::ostream & outputStream,
+    suffix_array_format suffixArrayFormat,
+    std::vector<out_of_core_entry> & group,
+    out_of_core_sample const & sample
+)
+{
+    auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
+    auto suffixesPerThread = ((inputSize_ + numThreads - 1) / numThreads);
+
+    // count the suffixes in each bucket.  each thread counts the suffixes which start in its part of the input.
+    std::vector<suffix_index> threadCount(numThreads * numBuckets, 0);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+        post_task_to_thread
+        (
+            threadId,
+            [&]
+            (
+                suffix_index begin,
+                suffix_index end,
+                suffix_index * count
+            )
+            {
+                for (auto suffixIndex = begin; suffixIndex < end; ++suffixIndex)
+                {
+                    auto bucket = classify(suffixIndex);
+                    if (bucket >= 0)
+                        ++count[bucket];
+                }
+            }, 
+            std::min(inputSize_, threadId * suffixesPerThread), std::min(inputSize_, (threadId + 1) * suffixesPerThread),
+            threadCount.data() + (threadId * numBuckets)
+        );
+    wait_for_all_tasks_completed();
+    std::vector<std::size_t> bucketSize(numBuckets, 0);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+        for (auto bucket = 0; bucket < numBuckets; ++bucket)
+            bucketSize[bucket] += threadCount[(threadId * numBuckets) + bucket];
+
+    auto sortGroup = [&]
+            (
+                std::int32_t bucketsBegin,
+                std::int32_t bucketsEnd
+            )
+            {
+                // compute where each thread gathers the suffixes of each bucket
+                std::vector<std::size_t> bucketOffset(bucketsEnd - bucketsBegin + 1, 0);
+                std::vector<std::size_t> threadOffset(numThreads * numBuckets);
+                for (auto bucket = bucketsBegin; bucket < bucketsEnd; ++bucket)
+                {
+                    auto offset = bucketOffset[bucket - bucketsBegin];
+                    for (auto threadId = 0; threadId < numThreads; ++threadId)
+                    {
+                        threadOffset[(threadId * numBuckets) + bucket] = offset;
+                        offset += threadCount[(threadId * numBuckets) + bucket];
+                    }
+                    bucketOffset[bucket - bucketsBegin + 1] = offset;
+                }
+                group.resize(bucketOffset.back());
+
+                for (auto threadId = 0; threadId < numThreads; ++threadId)
+                    post_task_to_thread
+                    (
+                        threadId,
+                        [&]
+                        (
+                            suffix_index begin,
+                            suffix_index end,
+                            std::size_t * offset
+                        )
+                        {
+                            for (auto suffixIndex = begin; suffixIndex < end; ++suffixIndex)
+                            {
+                                auto bucket = classify(suffixIndex);
+                                if ((bucket >= bucketsBegin) && (bucket < bucketsEnd))
+                                    group[offset[bucket]++] = {get_padded_prefix(suffixIndex), suffixIndex};
+                            }
+                        }, 
+                        std::min(inputSize_, threadId * suffixesPerThread), std::min(inputSize_, (threadId + 1) * suffixesPerThread),
+                        threadOffset.data() + (threadId * numBuckets)
+                    );
+                wait_for_all_tasks_completed();
+
+                std::atomic<std::int32_t> nextBucket(bucketsBegin);
+                for (auto threadId = 0; threadId < numThreads; ++threadId)
+                    post_task_to_thread
+                    (
+                        threadId,
+                        [&]
+                        (
+                        )
+                        {
+                            for (auto bucket = nextBucket++; bucket < bucketsEnd; bucket = nextBucket++)
+                                sort_out_of_core_entries(group.data() + bucketOffset[bucket - bucketsBegin], 
+                                        group.data() + bucketOffset[bucket - bucketsBegin + 1], sample);
+                        }
+                    );
+                wait_for_all_tasks_completed();
+
+                std::vector<suffix_index> output;
+                std::vector<std::uint8_t> packedOutput((suffixArrayFormat == packed_suffix_array_format) ? (0x10000 * packed_suffix_index_size) : 0);
+                output.reserve(0x10000);
+                for (std::size_t i = 0; i < group.size(); )
+                {
+                    output.clear();
+                    for (; ((i < group.size()) && (output.size() < 0x10000)); ++i)
+                        output.push_back(group[i].index_);
+                    if (suffixArrayFormat == packed_suffix_array_format)
+                    {
+                        pack_suffix_indexes(output.data(), output.data() + output.size(), packedOutput.data());
+                        outputStream.write((char const *)packedOutput.data(), output.size() * packed_suffix_index_size);
+                    }
+                    else
+                    {
+                        outputStream.write((char const *)output.data(), output.size() * sizeof(suffix_index));
+                    }
+                }
+            };
+
+    std::int32_t bucketsBegin = 0;
+    std::size_t groupSize = 0;
+    for (std::int32_t bucket = 0; bucket <= numBuckets; ++bucket)
+    {
+        auto size = (bucket < numBuckets) ? bucketSize[bucket] : 0;
+        auto oversized = (size > capacity);
+        if ((bucket == numBuckets) || (oversized) || ((groupSize + size) > capacity))
+        {
+            if (groupSize > 0)
+                sortGroup(bucketsBegin, bucket);
+            bucketsBegin = bucket;
+            groupSize = 0;
+        }
+        if (oversized)
+        {
+            splitBucket(bucket, size);
+            bucketsBegin = (bucket + 1);
+        }
+        else
+        {
+            groupSize += size;
+        }
+    }
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::make_suffix_array_out_of_core
+(
+    // private:
+    // sorts the suffixes which begin with the prefixLength bytes of 'prefix' and writes them to the 
+    // output stream.  the suffixes are bucketed by their next two bytes.  a bucket which exceeds the 
+    // capacity is bucketed in the same way on the two bytes which follow or, once its suffixes share
+    // their first eight bytes, split by splitter suffixes.
+    std::uint64_t prefix,
+    std::int32_t prefixLength,
+    std::size_t capacity,
+    std::ostream & outputStream,
+    suffix_array_format suffixArrayFormat,
+    std::vector<out_of_core_entry> & group,
+    out_of_core_sample const & sample
+)
+{
+    auto prefixShift = (((std::int32_t)sizeof(std::uint64_t) - prefixLength) * 8);
+    auto bucketShift = (prefixShift - 16);
+    make_suffix_array_out_of_core
+    (
+        [&](suffix_index suffixIndex) -> std::int32_t
+        {
+            auto suffixPrefix = get_padded_prefix(suffixIndex);
+            if ((prefixLength > 0) && ((suffixPrefix >> prefixShift) != prefix))
+                return -1;
+            return (std::int32_t)((suffixPrefix >> bucketShift) & 0xffff);
+        },
+        0x10000,
+        [&](std::int32_t bucket, std::size_t size)
+        {
+            auto bucketPrefix = ((prefix << 16) | bucket);
+            if ((prefixLength + 2) < (std::int32_t)sizeof(std::uint64_t))
+                make_suffix_array_out_of_core(bucketPrefix, prefixLength + 2, capacity, outputStream, suffixArrayFormat, group, sample);
+            else
+                split_out_of_core_bucket(bucketPrefix, -1, -1, size, capacity, outputStream, suffixArrayFormat, group, sample);
+        },
+        capacity, outputStream, suffixArrayFormat, group, sample
+    );
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::split_out_of_core_bucket
+(
+    // private:
+    // sorts the suffixes which begin with the eight bytes of 'prefix' and which sort at or after the 
+    // suffix at lowerBound and before the suffix at upperBound (each bound only where not negative).
+    // there are 'count' such suffixes which is more than the capacity.  candidates chosen among them
+    // by a hash of their positions are sorted and evenly spaced splitters are taken from the 
+    // candidates.  the suffixes are then bucketed by the splitters.  every bucket excludes at least 
+    // one of the suffixes so a bucket which still exceeds the capacity is split in turn.
+    std::uint64_t prefix,
+    suffix_index lowerBound,
+    suffix_index upperBound,
+    std::size_t count,
+    std::size_t capacity,
+    std::ostream & outputStream,
+    suffix_array_format suffixArrayFormat,
+    std::vector<out_of_core_entry> & group,
+    out_of_core_sample const & sample
+)
+{
+    static std::size_t constexpr max_splitters = 0xffff;
+    auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
+    auto suffixesPerThread = ((inputSize_ + numThreads - 1) / numThreads);
+    auto inRange = [&](suffix_index suffixIndex) -> bool
+            {
+                return ((get_padded_prefix(suffixIndex) == prefix) && 
+                        ((lowerBound < 0) || (!compare_out_of_core_suffixes(suffixIndex, lowerBound, 0, sample))) &&
+                        ((upperBound < 0) || (compare_out_of_core_suffixes(suffixIndex, upperBound, 0, sample))));
+            };
+
+    // each thread gathers the candidates from its part of the input into its share of the group
+    auto targetCandidates = std::min(capacity, count);
+    std::size_t candidates = 0;
+    for (std::uint64_t seed = ((std::uint64_t)lowerBound + 2) * 0xbf58476d1ce4e5b9ull; candidates < 2; ++seed)
+    {
+        group.resize(targetCandidates);
+        std::vector<std::size_t> threadCandidates(numThreads, 0);
+        for (auto threadId = 0; threadId < numThreads; ++threadId)
+            post_task_to_thread
+            (
+                threadId,
+                [&]
+                (
+                    suffix_index begin,
+                    suffix_index end,
+                    out_of_core_entry * shareBegin,
+                    out_of_core_entry * shareEnd,
+                    std::size_t * found
+                )
+                {
+                    auto shareCurrent = shareBegin;
+                    for (auto suffixIndex = begin; ((suffixIndex < end) && (shareCurrent < shareEnd)); ++suffixIndex)
+                    {
+                        auto hash = (((std::uint64_t)suffixIndex + seed) * 0x9e3779b97f4a7c15ull);
+                        hash ^= (hash >> 29);
+                        if (((hash % count) < targetCandidates) && (inRange(suffixIndex)))
+                            *shareCurrent++ = {get_padded_prefix(suffixIndex), suffixIndex};
+                    }
+                    *found = std::distance(shareBegin, shareCurrent);
+                }, 
+                std::min(inputSize_, threadId * suffixesPerThread), std::min(inputSize_, (threadId + 1) * suffixesPerThread),
+                group.data() + ((threadId * targetCandidates) / numThreads), group.data() + (((threadId + 1) * targetCandidates) / numThreads),
+                threadCandidates.data() + threadId
+            );
+        wait_for_all_tasks_completed();
+        candidates = 0;
+        for (auto threadId = 0; threadId < numThreads; ++threadId)
+        {
+            auto shareBegin = group.begin() + ((threadId * targetCandidates) / numThreads);
+            std::copy(shareBegin, shareBegin + threadCandidates[threadId], group.begin() + candidates);
+            candidates += threadCandidates[threadId];
+        }
+    }
+    sort_out_of_core_entries(group.data(), group.data() + candidates, sample);
+
+    auto numBuckets = std::min({max_splitters + 1, candidates, ((count << 1) + capacity - 1) / capacity});
+    std::vector<suffix_index> splitters(numBuckets - 1);
+    for (std::size_t i = 1; i < numBuckets; ++i)
+        splitters[i - 1] = group[(i * candidates) / numBuckets].index_;
+
+    make_suffix_array_out_of_core
+    (
+        [&](suffix_index suffixIndex) -> std::int32_t
+        {
+            if (!inRange(suffixIndex))
+                return -1;
+            return (std::int32_t)std::distance(splitters.begin(), std::upper_bound(splitters.begin(), splitters.end(), suffixIndex, 
+                    [&](suffix_index a, suffix_index splitter){return compare_out_of_core_suffixes(a, splitter, 0, sample);}));
+        },
+        (std::int32_t)numBuckets,
+        [&](std::int32_t bucket, std::size_t size)
+        {
+            split_out_of_core_bucket(prefix, (bucket == 0) ? lowerBound : splitters[bucket - 1], 
+                    (bucket == (std::int32_t)splitters.size()) ? upperBound : splitters[bucket], size, capacity, 
+                    outputStream, suffixArrayFormat, group, sample);
+        },
+        capacity, outputStream, suffixArrayFormat, group, sample
+    );
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::forward_burrows_wheeler_transform
+(
+    // public:
+    // computes the burrows wheeler transform for the input data and
+    // replaces the input data with that transformed result.
+    // returns the index of the sentinel character (which is removed from the
+    // transformed data).
+    uint8_t * inputBegin,
+    uint8_t * inputEnd
+) -> suffix_index
+{
+    auto workspaceSize = ((std::distance(inputBegin, inputEnd) + 1) * sizeof(suffix_index));
+    auto workspace = (suffix_index *)allocate_pages(workspaceSize);
+    auto sentinelIndex = forward_burrows_wheeler_transform(inputBegin, inputEnd, workspace);
+    release_pages(workspace, workspaceSize);
+    return sentinelIndex;
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::forward_burrows_wheeler_transform
+(
+    // public:
+    // as above but uses caller provided workspace which must hold
+    // (inputSize + 1) suffix indexes
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    suffix_index * workspace
+) -> suffix_index
+{
+    if (inputBegin == inputEnd)
+        return 0;
+    initialize(inputBegin, inputEnd, workspace);
+    first_stage_its();
+    auto sentinelIndex = second_stage_its_as_burrows_wheeler_transform();
+
+    // write the transform back to the input, skipping the sentinel, in parallel.  the input can not be
+    // overwritten any earlier since the second stage reads it until the very last suffix is induced.
+    auto numThreads = (std::int32_t)(numWorkerThreads_ + 1);
+    auto numSymbolsPerThread = ((inputSize_ + numThreads - 1) / numThreads);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        auto outputBegin = std::min(inputSize_, threadId * numSymbolsPerThread);
+        auto outputEnd = std::min(inputSize_, outputBegin + numSymbolsPerThread);
+        post_task_to_thread
+        (
+            threadId,
+            [&, outputBegin, outputEnd]
+            (
+            )
+            {
+                // output entries at or beyond the sentinel come from the entry which follows in the workspace
+                if (outputBegin < sentinelIndex)
+                    store_symbols(workspace + outputBegin, workspace + std::min(outputEnd, sentinelIndex), inputBegin + outputBegin);
+                if (outputEnd > sentinelIndex)
+                {
+                    auto begin = std::max(outputBegin, sentinelIndex);
+                    store_symbols(workspace + begin + 1, workspace + outputEnd + 1, inputBegin + begin);
+                }
+            }
+        );
+    }
+    wait_for_all_tasks_completed();
+    return sentinelIndex;
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::forward_burrows_wheeler_transform
+(
+    // public:
+    // as above but obtains the workspace from the provided memory resource
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    std::pmr::memory_resource * memoryResource
+) -> suffix_index
+{
+    auto workspaceSize = ((std::distance(inputBegin, inputEnd) + 1) * sizeof(suffix_index));
+    auto workspace = (suffix_index *)memoryResource->allocate(workspaceSize, alignof(suffix_index));
+    auto sentinelIndex = forward_burrows_wheeler_transform(inputBegin, inputEnd, workspace);
+    memoryResource->deallocate(workspace, workspaceSize, alignof(suffix_index));
+    return sentinelIndex;
+}
+
+
+//==============================================================================
+auto maniscalco::msufsort::forward_burrows_wheeler_transform
+(
+    // public:
+    // as above but also returns the anchors.  anchors[i] is the sorted index of the suffix 
+    // at (i << anchorIntervalShift) which allows the transform to be reversed as independent
+    // spans of (1 << anchorIntervalShift) symbols each.
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    int32_t anchorIntervalShift,
+    std::vector<suffix_index> & anchors
+) -> suffix_index
+{
+    if ((anchorIntervalShift < 0) || (anchorIntervalShift > max_anchor_interval_shift))
+        throw std::invalid_argument("msufsort: anchor interval shift out of range");
+    auto inputSize = (suffix_index)std::distance(inputBegin, inputEnd);
+    // one extra anchor in case the empty suffix (at inputSize) falls on the interval
+    anchors.resize((inputSize >> anchorIntervalShift) + 1);
+    anchors_ = anchors.data();
+    anchorIntervalMask_ = (((suffix_index)1 << anchorIntervalShift) - 1);
+    anchorIntervalShift_ = anchorIntervalShift;
+    auto sentinelIndex = forward_burrows_wheeler_transform(inputBegin, inputEnd);
+    anchors_ = nullptr;
+    anchors.resize((inputSize > 0) ? (((inputSize - 1) >> anchorIntervalShift) + 1) : 0);
+    if (!anchors.empty())
+        anchors[0] = sentinelIndex;
+    return sentinelIndex;
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // public:
+    // reverses the burrows wheeler transform in place using either the fast or the
+    // compact (less memory) reverse transform.  runs on this instance's worker threads 
+    // which makes it the better choice when reversing many (small) blocks.
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    suffix_index sentinelIndex,
+    reverse_transform_mode reverseTransformMode
+)
+{
+    if (inputBegin == inputEnd)
+        return;
+    if (reverseTransformMode == compact_reverse_transform)
+        compact_reverse_burrows_wheeler_transform(inputBegin, inputEnd, sentinelIndex);
+    else
+        reverse_burrows_wheeler_transform<ibwt_symbol_entry>(inputBegin, inputEnd, sentinelIndex);
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // public:
+    // as above but on (numThreads - 1) worker threads which exist only for the duration of the call
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    suffix_index sentinelIndex,
+    int32_t numThreads,
+    reverse_transform_mode reverseTransformMode
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort(numThreads).reverse_burrows_wheeler_transform(inputBegin, inputEnd, sentinelIndex, reverseTransformMode);
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // public:
+    // reverses a transform made by forward_burrows_wheeler_transform with anchors.
+    // the spans between anchors are decoded independently in parallel and need no
+    // stitching afterwards.
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    std::vector<suffix_index> const & anchors,
+    int32_t anchorIntervalShift,
+    reverse_transform_mode reverseTransformMode
+)
+{
+    if ((anchorIntervalShift < 0) || (anchorIntervalShift > max_anchor_interval_shift))
+        throw std::invalid_argument("msufsort: anchor interval shift out of range");
+    if (reverseTransformMode == compact_reverse_transform)
+        compact_reverse_burrows_wheeler_transform(inputBegin, inputEnd, anchors, anchorIntervalShift);
+    else
+        reverse_burrows_wheeler_transform<ibwt_symbol_entry>(inputBegin, inputEnd, anchors, anchorIntervalShift);
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // public:
+    // as above but on (numThreads - 1) worker threads which exist only for the duration of the call
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    std::vector<suffix_index> const & anchors,
+    int32_t anchorIntervalShift,
+    int32_t numThreads,
+    reverse_transform_mode reverseTransformMode
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort(numThreads).reverse_burrows_wheeler_transform(inputBegin, inputEnd, anchors, anchorIntervalShift, reverseTransformMode);
+}
+
+
+//==============================================================================
+void maniscalco::msufsort::forward_burrows_wheeler_transform_blocks
+(
+    // public:
+    // transforms a stream of blocks of up to blockSize bytes each.  reading, transforming and writing
+    // overlap.  the thread budget is divided into lanes which each transform one block at a time.  
+    // large blocks get several threads per lane whereas small blocks get a lane per thread.  at most
+    // two blocks per lane are in flight (read but not yet written) at once.
+    block_reader blockReader,
+    block_writer blockWriter,
+    std::size_t blockSize,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (blockSize == 0)
+        blockSize = 1;
+    if (blockSize > (std::size_t)max_input_size)
+        blockSize = (std::size_t)max_input_size;
+    auto threadsPerLane = std::max<int32_t>(1, std::min<std::size_t>(numThreads, blockSize / min_block_size_per_thread));
+    auto numLanes = std::max<int32_t>(1, numThreads / threadsPerLane);
+    std::size_t maxBlocksInFlight = (numLanes * 2);
+
+    struct block
+    {
+        std::vector<uint8_t> data_;
+        suffix_index sentinelIndex_;
+        bool transformed_;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::unique_ptr<block>> blocksInFlight;  // in input order
+    std::deque<block *> untransformedBlocks;
+    std::vector<std::unique_ptr<block>> freeBlocks;
+    bool endOfInput = false;
+
+    // the first exception thrown by the reader, a lane or the writer stops the pipeline.
+    // it is rethrown once every task has returned.
+    std::exception_ptr exception;
+    auto stop_pipeline = [&]
+            (
+            )
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!exception)
+                    exception = std::current_exception();
+                condition.notify_all();
+            };
+
+    // worker 0 reads, workers 1 through numLanes each run a lane and the calling thread writes
+    msufsort pipeline(numLanes + 2);
+    pipeline.post_task_to_thread
+    (
+        0,
+        [&]
+        (
+        )
+        {
+            try
+            {
+                while (true)
+                {
+                    std::unique_ptr<block> currentBlock;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [&](){return ((exception) || (blocksInFlight.size() < maxBlocksInFlight));});
+                        if (exception)
+                            return;
+                        if (!freeBlocks.empty())
+                        {
+                            currentBlock = std::move(freeBlocks.back());
+                            freeBlocks.pop_back();
+                        }
+                    }
+                    if (!currentBlock)
+                        currentBlock.reset(new block);
+                    currentBlock->data_.resize(blockSize);
+                    std::size_t size = 0;
+                    while (size < blockSize)
+                    {
+                        auto bytesRead = blockReader(currentBlock->data_.data() + size, blockSize - size);
+                        if (bytesRead == 0)
+                            break;
+                        size += bytesRead;
+                    }
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (size == 0)
+                    {
+                        endOfInput = true;
+                        condition.notify_all();
+                        return;
+                    }
+                    currentBlock->data_.resize(size);
+                    currentBlock->transformed_ = false;
+                    untransformedBlocks.push_back(currentBlock.get());
+                    blocksInFlight.push_back(std::move(currentBlock));
+                    condition.notify_all();
+                }
+            }
+            catch (...)
+            {
+                stop_pipeline();
+            }
+        }
+    );
+
+    for (auto laneId = 0; laneId < numLanes; ++laneId)
+    {
+        pipeline.post_task_to_thread
+        (
+            laneId + 1,
+            [&]
+            (
+            )
+            {
+                try
+                {
+                    msufsort lane(threadsPerLane);
+                    suffix_array workspace(blockSize + 1);
+                    while (true)
+                    {
+                        block * currentBlock = nullptr;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            condition.wait(lock, [&](){return ((exception) || (!untransformedBlocks.empty()) || (endOfInput));});
+                            if ((exception) || (untransformedBlocks.empty()))
+                                return;
+                            currentBlock = untransformedBlocks.front();
+                            untransformedBlocks.pop_front();
+                        }
+                        auto & data = currentBlock->data_;
+                        currentBlock->sentinelIndex_ = lane.forward_burrows_wheeler_transform(data.data(), data.data() + data.size(), workspace.data());
+                        std::unique_lock<std::mutex> lock(mutex);
+                        currentBlock->transformed_ = true;
+                        condition.notify_all();
+                    }
+                }
+                catch (...)
+                {
+                    stop_pipeline();
+                }
+            }
+        );
+    }
 
-    // spread b* to their final locations in suffix array
-    auto destination = suffixArrayBegin_ + total;
-    auto source = suffixArrayBegin_ + bStarTotal;
-    for (int32_t i = 0xffff; i >= 0; --i)
+    // write the blocks in order as each is transformed
+    try
     {
-        if (bCount[i] || aCount[i])
+        while (true)
         {
-            destination -= bCount[i];
-            source -= totalBStarCount[i];
-            for (auto j = totalBStarCount[i] - 1; j >= 0; --j)
-                destination[j] = source[j];
-            for (auto j = totalBStarCount[i]; j < bCount[i]; ++j)
-                destination[j] = suffix_is_unsorted_b_type;
-            destination -= aCount[i];
-            for (auto j = 0; j < aCount[i]; ++j)
-                destination[j] = preceding_suffix_is_type_a_flag;
+            std::unique_ptr<block> currentBlock;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&](){return ((exception) || ((blocksInFlight.empty()) ? endOfInput : blocksInFlight.front()->transformed_));});
+                if ((exception) || (blocksInFlight.empty()))
+                    break;
+                currentBlock = std::move(blocksInFlight.front());
+                blocksInFlight.pop_front();
+            }
+            auto const & data = currentBlock->data_;
+            blockWriter(data.data(), data.data() + data.size(), currentBlock->sentinelIndex_);
+            std::unique_lock<std::mutex> lock(mutex);
+            freeBlocks.push_back(std::move(currentBlock));
+            condition.notify_all();
         }
     }
-    suffixArrayBegin_[0] = (inputSize_ | preceding_suffix_is_type_a_flag); // sa[0] = sentinel
+    catch (...)
+    {
+        stop_pipeline();
+    }
 
-    finish = std::chrono::system_clock::now();
-    #ifdef VERBOSE
-        std::cout << "direct sort time: " << std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count() << " ms " << std::endl;
-    #endif
+    pipeline.wait_for_all_tasks_completed();
+    if (exception)
+        std::rethrow_exception(exception);
 }
 
 
 //==============================================================================
-auto maniscalco::msufsort::make_suffix_array
+void maniscalco::msufsort::forward_burrows_wheeler_transform_blocks
 (
     // public:
-    // computes the suffix array for the input data
-    uint8_t const * inputBegin,
-    uint8_t const * inputEnd
-) -> suffix_array
+    // as above but reads the blocks from the input stream
+    std::istream & inputStream,
+    block_writer blockWriter,
+    std::size_t blockSize,
+    int32_t numThreads
+)
 {
-    inputBegin_ = inputBegin;
-    inputEnd_ = inputEnd;
-    inputSize_ = std::distance(inputBegin_, inputEnd_);
-    getValueEnd_ = (inputEnd_ - sizeof(suffix_value));
-    getValueMaxIndex_ = (inputSize_ - sizeof(suffix_value));
-    for (auto & e : copyEnd_)
-        e = 0x00;
-    auto source = inputEnd_ - sizeof(suffix_value);
-    auto dest = copyEnd_;
-    if (source < inputBegin_)
-    {
-        auto n = std::distance(source, inputBegin);
-        source += n;
-        dest += n;
-    }
-    std::copy(source, inputEnd_, dest);
-    suffix_array suffixArray;
-    auto suffixArraySize = (inputSize_ + 1);
-    suffixArray.resize(suffixArraySize);
-    for (auto & e : suffixArray)
-        e = 0;
-    suffixArrayBegin_ = suffixArray.data();
-    suffixArrayEnd_ = suffixArrayBegin_ + suffixArraySize;
-    inverseSuffixArrayBegin_ = (suffixArrayBegin_ + ((inputSize_ + 1) >> 1));
-    inverseSuffixArrayEnd_ = suffixArrayEnd_;
+    forward_burrows_wheeler_transform_blocks
+    (
+        [&inputStream](uint8_t * buffer, std::size_t size) -> std::size_t
+        {
+            inputStream.read((char *)buffer, size);
+            return (std::size_t)inputStream.gcount();
+        }, 
+        blockWriter, blockSize, numThreads
+    );
+}
 
-    first_stage_its();
-    second_stage_its();
-    return suffixArray;
+
+//==============================================================================
+inline void maniscalco::msufsort::set_ibwt_entry
+(
+    // private:
+    // sets the reverse transform index entry along with its symbol
+    ibwt_symbol_entry & entry,
+    suffix_index value,
+    std::uint8_t symbol
+)
+{
+    entry.value_ = value;
+    entry.symbol_ = symbol;
 }
 
 
 //==============================================================================
-int32_t maniscalco::msufsort::forward_burrows_wheeler_transform
+template <std::size_t width>
+inline void maniscalco::msufsort::set_ibwt_entry
 (
-    // public:
-    // computes the burrows wheeler transform for the input data and
-    // replaces the input data with that transformed result.
-    // returns the index of the sentinel character (which is removed from the
-    // transformed data).
-    uint8_t * inputBegin,
-    uint8_t * inputEnd
+    // private:
+    // sets the reverse transform index entry.  the symbol is implied by the entry's bucket
+    ibwt_compact_entry<width> & entry,
+    suffix_index value,
+    std::uint8_t
 )
 {
-    inputBegin_ = inputBegin;
-    inputEnd_ = inputEnd;
-    inputSize_ = std::distance(inputBegin_, inputEnd_);
+    for (std::size_t i = 0; i < width; ++i, value >>= 8)
+        entry.value_[i] = (std::uint8_t)value;
+}
 
-    getValueEnd_ = (inputEnd_ - sizeof(suffix_value));
-    getValueMaxIndex_ = (inputSize_ - sizeof(suffix_value));
-    for (auto & e : copyEnd_)
-        e = 0x00;
-    auto source = inputEnd_ - sizeof(suffix_value);
-    auto dest = copyEnd_;
-    if (source < inputBegin_)
-    {
-        auto n = std::distance((uint8_t const *)source, (uint8_t const *)inputBegin);
-        source += n;
-        dest += n;
-    }
-    std::copy(source, inputEnd_, dest);
-    suffix_array suffixArray;
-    auto suffixArraySize = (inputSize_ + 1);
-    suffixArray.resize(suffixArraySize);
-    for (auto & e : suffixArray)
-        e = 0;
-    suffixArrayBegin_ = suffixArray.data();
-    suffixArrayEnd_ = suffixArrayBegin_ + suffixArraySize;
-    inverseSuffixArrayBegin_ = (suffixArrayBegin_ + ((inputSize_ + 1) >> 1));
-    inverseSuffixArrayEnd_ = suffixArrayEnd_;
 
-    first_stage_its();
-    int32_t sentinelIndex = second_stage_its_as_burrows_wheeler_transform();
-    for (int32_t i = 0; i < (inputSize_ + 1); ++i)
-    {
-        if (i != sentinelIndex)
-            *inputBegin++ = (uint8_t)suffixArray[i];
-    }
-    return sentinelIndex;
+//==============================================================================
+inline auto maniscalco::msufsort::get_ibwt_index
+(
+    // private:
+    // returns the index stored in the reverse transform index entry
+    ibwt_symbol_entry const & entry
+) -> suffix_index
+{
+    return entry.value_;
 }
 
 
 //==============================================================================
-void maniscalco::msufsort::reverse_burrows_wheeler_transform
+template <std::size_t width>
+inline auto maniscalco::msufsort::get_ibwt_index
 (
-    uint8_t * inputBegin,
-    uint8_t * inputEnd,
-    int32_t sentinelIndex,
-    int32_t numThreads
+    // private:
+    // returns the index stored in the packed reverse transform index entry.  the entry's 
+    // partition start flag is moved to the high bit of the suffix index.
+    ibwt_compact_entry<width> const & entry
+) -> suffix_index
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = width; i-- > 0; )
+        value = ((value << 8) | entry.value_[i]);
+    auto startFlag = (value >> ((width << 3) - 1));
+    return ((suffix_index)(value & ibwt_compact_entry<width>::max_index) | (ibwt_partition_start_flag & -(suffix_index)startFlag));
+}
+
+
+//==============================================================================
+inline void maniscalco::msufsort::set_ibwt_partition_start
+(
+    // private:
+    // flags the entry as the start of a decode partition
+    ibwt_symbol_entry & entry
 )
 {
-    #pragma pack(push, 1)
-    struct index_type
-    {
-        index_type(){}
-        index_type(suffix_index v, std::uint8_t s){value_ = v; symbol_ = s;}
-        suffix_index value_;
-        std::uint8_t symbol_;
-    };
-    #pragma pack(pop)
+    entry.value_ |= ibwt_partition_start_flag;
+}
+
+
+//==============================================================================
+template <std::size_t width>
+inline void maniscalco::msufsort::set_ibwt_partition_start
+(
+    // private:
+    // flags the packed entry as the start of a decode partition
+    ibwt_compact_entry<width> & entry
+)
+{
+    entry.value_[width - 1] |= 0x80;
+}
+
+
+//==============================================================================
+inline std::uint8_t maniscalco::msufsort::get_ibwt_symbol
+(
+    // private:
+    // returns the symbol decoded at index 'current'.  read from the index entry.
+    ibwt_symbol_entry const * index,
+    suffix_index current,
+    std::uint8_t
+)
+{
+    return index[current].symbol_;
+}
+
+
+//==============================================================================
+template <std::size_t width>
+inline std::uint8_t maniscalco::msufsort::get_ibwt_symbol
+(
+    // private:
+    // returns the symbol decoded at index 'current'.  this is the symbol found by 
+    // get_next_ibwt_symbol on the previous step.
+    ibwt_compact_entry<width> const *,
+    suffix_index,
+    std::uint8_t symbol
+)
+{
+    return symbol;
+}
+
+
+//==============================================================================
+inline std::uint8_t maniscalco::msufsort::get_next_ibwt_symbol
+(
+    // private:
+    // the symbol entries carry their own symbols so there is nothing to find
+    ibwt_symbol_entry const *,
+    suffix_index,
+    ibwt_symbol_lookup const &
+)
+{
+    return 0;
+}
+
+
+//==============================================================================
+template <std::size_t width>
+inline std::uint8_t maniscalco::msufsort::get_next_ibwt_symbol
+(
+    // private:
+    // returns the symbol which will be decoded at the index which follows index 'current'.  
+    // this is the symbol of the bucket which holds 'current'.
+    ibwt_compact_entry<width> const *,
+    suffix_index current,
+    ibwt_symbol_lookup const & symbolLookup
+)
+{
+    auto symbol = symbolLookup.blockSymbol_[current >> ibwt_symbol_block_shift];
+    while (current >= symbolLookup.bucketBegin_[symbol + 1])
+        ++symbol;
+    return symbol;
+}
+
+
+//==============================================================================
+template <typename ibwt_entry>
+void maniscalco::msufsort::build_ibwt_index
+(
+    // private:
+    // populates the reverse transform index and the symbol lookup for the transformed input
+    uint8_t const * inputBegin,
+    uint8_t const * inputEnd,
+    suffix_index sentinelIndex,
+    std::vector<ibwt_entry> & index,
+    ibwt_symbol_lookup & symbolLookup
+)
+{
+    auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
     auto inputSize = std::distance(inputBegin, inputEnd);
-    std::vector<index_type> index;
     index.resize(inputSize + 1);
 
     {
         // populate 'index'
-        std::int32_t symbolRange[numThreads][0x100];
+        suffix_index symbolRange[numThreads][0x100];
         for (auto & e1 : symbolRange)
             for (auto & e2 : e1)
                 e2 = 0;
         auto bytesPerThread = ((inputSize + numThreads - 1) / numThreads);
-        std::vector<std::thread> threads;
-        threads.resize(numThreads);
 
-        auto bytesProcessed = 0;
+        suffix_index bytesProcessed = 0;
         for (auto threadId = 0; threadId < numThreads; ++threadId)
         {
             auto bytesForThisThread = bytesPerThread;
             if ((bytesProcessed + bytesForThisThread) > inputSize)
                 bytesForThisThread = (inputSize - bytesProcessed);
-            threads[threadId] = std::thread([]
+            post_task_to_thread(threadId, []
                     (
                         uint8_t const * data, 
-                        int32_t size, 
-                        int32_t * result
+                        suffix_index size, 
+                        suffix_index * result
                     )
                     {
-                        std::int32_t symbolCount[0x10000] = {};
-                        for (auto i = 0; i < size - 1; i += 2)
+                        suffix_index symbolCount[0x10000] = {};
+                        for (suffix_index i = 0; i < size - 1; i += 2)
                             ++symbolCount[*(uint16_t const *)(data + i)];
                         for (auto i = 0; i < 0x10000; ++i)
                         {
@@ -1852,9 +4473,8 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
                     }, inputBegin + bytesProcessed, bytesForThisThread, symbolRange[threadId]);
             bytesProcessed += bytesForThisThread;
         }
-        for (auto & e : threads)
-            e.join();
-        int32_t n = 1;
+        wait_for_all_tasks_completed();
+        suffix_index n = 1;
         for (auto i = 0; i < 0x100; ++i)
         {
             for (auto threadId = 0; threadId < numThreads; ++threadId)
@@ -1865,20 +4485,35 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
             }
         }
 
-        index[0] = {sentinelIndex, inputBegin[0]};
+        for (auto i = 0; i < 0x100; ++i)
+            symbolLookup.bucketBegin_[i] = symbolRange[0][i];
+        symbolLookup.bucketBegin_[0x100] = (inputSize + 1);
+        if constexpr (!std::is_same<ibwt_entry, ibwt_symbol_entry>::value)
+        {
+            symbolLookup.blockSymbol_.resize((inputSize >> ibwt_symbol_block_shift) + 1);
+            std::uint32_t symbol = 0;
+            for (std::size_t i = 0; i < symbolLookup.blockSymbol_.size(); ++i)
+            {
+                while ((suffix_index)(i << ibwt_symbol_block_shift) >= symbolLookup.bucketBegin_[symbol + 1])
+                    ++symbol;
+                symbolLookup.blockSymbol_[i] = symbol;
+            }
+        }
+
+        set_ibwt_entry(index[0], sentinelIndex, inputBegin[0]);
         bytesProcessed = 0;
         for (auto threadId = 0; threadId < numThreads; ++threadId)
         {
             auto bytesForThisThread = bytesPerThread;
             if ((bytesProcessed + bytesForThisThread) > inputSize)
                 bytesForThisThread = (inputSize - bytesProcessed);
-            threads[threadId] = std::thread([sentinelIndex]
+            post_task_to_thread(threadId, [sentinelIndex]
                     (
                         uint8_t const * data, 
-                        int32_t begin, 
-                        int32_t end, 
-                        int32_t * symbolRange, 
-                        index_type * index
+                        suffix_index begin, 
+                        suffix_index end, 
+                        suffix_index * symbolRange, 
+                        ibwt_entry * index
                     )
                     {
                         auto n = begin;
@@ -1887,14 +4522,81 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
                         {
                             n += (i == sentinelIndex);
                             auto k = symbolRange[(uint32_t)data[i]]++;
-                            index[k] = {n, data[k - (k >= sentinelIndex)]};
+                            set_ibwt_entry(index[k], n, data[k - (k >= sentinelIndex)]);
                         }
                     }, inputBegin, bytesProcessed, bytesProcessed + bytesForThisThread, symbolRange[threadId], index.data());
             bytesProcessed += bytesForThisThread;
         }
-        for (auto & e : threads)
-            e.join();
+        wait_for_all_tasks_completed();
+    }
+
+}
+
+
+//==============================================================================
+template <typename ibwt_entry>
+void maniscalco::msufsort::decode_ibwt_partitions
+(
+    // private:
+    // decodes each partition until it reaches the start of another partition or the end of its output space.
+    // each partition is an independent decode cursor.  the cursors are stepped round robin so that the 
+    // (random) index lookups of all cursors are in flight together.  the index entry for each cursor's 
+    // next step is prefetched one round ahead of its use.
+    ibwt_entry const * indexBegin,
+    ibwt_symbol_lookup const * symbolLookup,
+    suffix_index sentinelIndex,
+    ibwt_partition_info * partitionBegin, 
+    ibwt_partition_info * partitionEnd
+)
+{
+    std::vector<ibwt_partition_info *> cursors;
+    for (auto partitionCurrent = partitionBegin; partitionCurrent < partitionEnd; ++partitionCurrent)
+        if (((partitionCurrent->currentIndex_ & ibwt_partition_start_flag) == 0) && (partitionCurrent->currentOutput_ < partitionCurrent->endOutput_))
+            cursors.push_back(partitionCurrent);
+    while (!cursors.empty())
+    {
+        for (std::size_t cursor = 0; cursor < cursors.size(); )
+        {
+            auto & e = *cursors[cursor];
+            auto i = e.currentIndex_;
+            *e.currentOutput_ = get_ibwt_symbol(indexBegin, i, e.symbol_);
+            e.currentOutput_ += (i != sentinelIndex);
+            e.currentIndex_ = get_ibwt_index(indexBegin[i]);
+            e.symbol_ = get_next_ibwt_symbol(indexBegin, i, *symbolLookup);
+            #ifdef __GNUC__
+                __builtin_prefetch(indexBegin + (e.currentIndex_ & ibwt_partition_index_mask));
+            #endif
+            if ((e.currentIndex_ & ibwt_partition_start_flag) || (e.currentOutput_ >= e.endOutput_))
+            {
+                // cursor has reached the start of another partition or the end of its output space
+                cursors[cursor] = cursors.back();
+                cursors.pop_back();
+            }
+            else
+            {
+                ++cursor;
+            }
+        }
     }
+}
+
+
+//==============================================================================
+template <typename ibwt_entry>
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // private:
+    // the reverse transform using index entries of type ibwt_entry
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    suffix_index sentinelIndex
+)
+{
+    auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
+    auto inputSize = std::distance(inputBegin, inputEnd);
+    std::vector<ibwt_entry> index;
+    ibwt_symbol_lookup symbolLookup;
+    build_ibwt_index(inputBegin, inputEnd, sentinelIndex, index, symbolLookup);
 
     std::size_t maxPartitionsPerThread = 256;
     std::vector<ibwt_partition_info> ibwtPartitionInfo;
@@ -1904,24 +4606,23 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
     ibwtPartitionInfo.reserve(partitionCount + 8192);
     std::size_t maxBytesPerPartition = (((index.size() << 1) - 1) / partitionCount);
 
-    auto firstDecodeIndex = index[0].value_;
+    auto firstDecodeIndex = get_ibwt_index(index[0]);
     auto outputCurrent = inputBegin;
-    auto currentIndex = 0;
-    while (currentIndex < (std::int32_t)index.size())
+    suffix_index currentIndex = 0;
+    while (currentIndex < (suffix_index)index.size())
     {
         auto partitionSize = maxBytesPerPartition;
         if ((currentIndex + partitionSize) > index.size())
             partitionSize = (index.size() - currentIndex);
-        ibwtPartitionInfo.push_back({index[currentIndex].value_, index[currentIndex].value_, outputCurrent, outputCurrent,
+        ibwtPartitionInfo.push_back({get_ibwt_index(index[currentIndex]), get_ibwt_index(index[currentIndex]), 
+                get_next_ibwt_symbol(index.data(), currentIndex, symbolLookup), outputCurrent, outputCurrent,
                 ((outputCurrent + partitionSize) <= inputEnd) ? (outputCurrent + partitionSize) : inputEnd});
-        index[currentIndex].value_ |= 0x80000000;
+        set_ibwt_partition_start(index[currentIndex]);
         currentIndex += partitionSize;
         outputCurrent += partitionSize;
     }
     partitionCount = ibwtPartitionInfo.size();
 
-    std::vector<std::thread> threads;
-    threads.resize(numThreads);
     struct decoded_info
     {
         decoded_info(){}
@@ -1962,51 +4663,25 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
             if (numPartitions > partitionsRemaining)
                 numPartitions = partitionsRemaining;
             partitionsRemaining -= numPartitions;
-            threads[threadId] = std::thread(
-                    [](
-                        index_type * indexBegin,
-                        suffix_index sentinelIndex,
-                        ibwt_partition_info * partitionBegin, 
-                        ibwt_partition_info * partitionEnd
-                    )
-                    {
-                        bool done = false;
-                        while (!done)
-                        {
-                            done = true;
-                            for (auto partitionCurrent = partitionBegin; partitionCurrent < partitionEnd; ++partitionCurrent)
-                            {
-                                auto & e = *partitionCurrent;
-                                if (((e.currentIndex_ & (suffix_index)0x80000000) == 0) && (e.currentOutput_ < e.endOutput_))
-                                {
-                                    done = false;
-                                    auto i = e.currentIndex_;
-                                    *e.currentOutput_ = indexBegin[i].symbol_;
-                                    e.currentOutput_ += (i != sentinelIndex);
-                                    e.currentIndex_ = indexBegin[i].value_;
-                                }
-                            }
-                        }
-                    },
-                    index.data(), sentinelIndex, ibwtPartitionInfo.data() + partitionsRemaining, 
+            post_task_to_thread(threadId, decode_ibwt_partitions<ibwt_entry>,
+                    index.data(), &symbolLookup, sentinelIndex, ibwtPartitionInfo.data() + partitionsRemaining, 
                     ibwtPartitionInfo.data() + partitionsRemaining + numPartitions);
         }
-        for (auto & e : threads)
-            e.join();
+        wait_for_all_tasks_completed();
 
         for (auto iter = ibwtPartitionInfo.begin(); iter != ibwtPartitionInfo.end(); )
         {
             if (iter->currentOutput_ != nullptr)
             {
                 auto startIndex = iter->startIndex_;
-                auto endIndex = (iter->currentIndex_ & 0x7fffffff);
-                if ((iter->currentIndex_ & 0x80000000) || (iter->beginOutput_ != iter->currentOutput_))
+                auto endIndex = (iter->currentIndex_ & ibwt_partition_index_mask);
+                if ((iter->currentIndex_ & ibwt_partition_start_flag) || (iter->beginOutput_ != iter->currentOutput_))
                 {
                     decodedInfo.push_back({iter->beginOutput_, iter->currentOutput_, startIndex, endIndex});
                     iter->startIndex_ = endIndex;
                 }
             }
-            if (iter->currentIndex_ & 0x80000000)
+            if (iter->currentIndex_ & ibwt_partition_start_flag)
             {
                 if (iter->currentOutput_ < iter->endOutput_)
                     availableDecodeSpace.push_back(std::make_pair(iter->currentOutput_, iter->endOutput_));
@@ -2039,36 +4714,128 @@ void maniscalco::msufsort::reverse_burrows_wheeler_transform
         }
     }
 
-    std::uint8_t const * curDec = nullptr;
-    std::uint8_t const * curDecEnd = nullptr;
-    suffix_index curEndIndex = 0;
-
-    for (std::size_t i = 0; i < decodedInfo.size(); ++i)
-        if (decodedInfo[i].startIndex_ == firstDecodeIndex)
-        {
-            curDec = decodedInfo[i].begin_;
-            curDecEnd = decodedInfo[i].end_;
-            curEndIndex = decodedInfo[i].endIndex_;
-            break;
-        }
+    // stitch the decoded segments together.  each segment is followed by the segment which starts
+    // at its end index.  index the segments by start index and walk the chain once to find the 
+    // output offset of each segment.
+    std::sort(decodedInfo.begin(), decodedInfo.end(), [](decoded_info const & a, decoded_info const & b) -> bool{return (a.startIndex_ < b.startIndex_);});
+    auto findSegment = [&](suffix_index startIndex) -> decoded_info const *
+            {
+                auto iter = std::lower_bound(decodedInfo.begin(), decodedInfo.end(), startIndex, 
+                        [](decoded_info const & a, suffix_index startIndex) -> bool{return (a.startIndex_ < startIndex);});
+                return (((iter == decodedInfo.end()) || (iter->startIndex_ != startIndex)) ? nullptr : &*iter);
+            };
+    std::vector<std::pair<suffix_index, decoded_info const *>> segments; // output offset and segment
+    segments.reserve(decodedInfo.size());
+    suffix_index outputSize = 0;
+    for (auto segment = findSegment(firstDecodeIndex); ((segment != nullptr) && (outputSize < inputSize)); segment = findSegment(segment->endIndex_))
+    {
+        segments.push_back(std::make_pair(outputSize, segment));
+        outputSize += std::distance(segment->begin_, segment->end_);
+    }
 
+    // the decoded segments occupy the input so they are first gathered into the (no longer needed) 
+    // index and then copied back to the input.  both copies are split evenly across the threads.
     auto beginWrite = (std::uint8_t *)index.data();
-    auto currentWrite = beginWrite;
-    auto endWrite = (currentWrite + inputSize);
-    while (currentWrite < endWrite)
-    {
-        while ((currentWrite < endWrite) && (curDec < curDecEnd))
-            *currentWrite++ = *curDec++;
-        for (std::size_t j = 0; j < decodedInfo.size(); ++j)
-            if (decodedInfo[j].startIndex_ == curEndIndex)
-            {
-                curDec = decodedInfo[j].begin_;
-                curDecEnd = decodedInfo[j].end_;
-                curEndIndex = decodedInfo[j].endIndex_;
-                break;
-            }
+    auto bytesPerThread = ((inputSize + numThreads - 1) / numThreads);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread(threadId, [&]
+                (
+                    suffix_index begin,
+                    suffix_index end
+                )
+                {
+                    auto segment = std::upper_bound(segments.begin(), segments.end(), begin, 
+                            [](suffix_index offset, std::pair<suffix_index, decoded_info const *> const & a) -> bool{return (offset < a.first);});
+                    if (segment != segments.begin())
+                        --segment;
+                    for (; ((segment != segments.end()) && (segment->first < end)); ++segment)
+                    {
+                        auto copyBegin = std::max(begin, segment->first);
+                        auto copyEnd = std::min(end, segment->first + (suffix_index)std::distance(segment->second->begin_, segment->second->end_));
+                        if (copyBegin < copyEnd)
+                            std::copy(segment->second->begin_ + (copyBegin - segment->first), segment->second->begin_ + (copyEnd - segment->first), beginWrite + copyBegin);
+                    }
+                }, std::min(inputSize, threadId * bytesPerThread), std::min(inputSize, (threadId + 1) * bytesPerThread));
+    }
+    wait_for_all_tasks_completed();
+
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        post_task_to_thread(threadId, [&]
+                (
+                    suffix_index begin,
+                    suffix_index end
+                )
+                {
+                    std::copy(beginWrite + begin, beginWrite + end, inputBegin + begin);
+                }, std::min(inputSize, threadId * bytesPerThread), std::min(inputSize, (threadId + 1) * bytesPerThread));
+    }
+    wait_for_all_tasks_completed();
+}
+
+
+//==============================================================================
+template <typename ibwt_entry>
+void maniscalco::msufsort::reverse_burrows_wheeler_transform
+(
+    // private:
+    // the reverse transform from anchors using index entries of type ibwt_entry.  the span of
+    // output which follows each anchor is decoded starting from the anchor's sorted index.  the
+    // spans are split evenly across the threads.
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    std::vector<suffix_index> const & anchors,
+    int32_t anchorIntervalShift
+)
+{
+    if (anchors.empty())
+        return;
+    auto numThreads = (int32_t)(numWorkerThreads_ + 1); // +1 for main thread
+    std::vector<ibwt_entry> index;
+    ibwt_symbol_lookup symbolLookup;
+    build_ibwt_index(inputBegin, inputEnd, anchors[0], index, symbolLookup);
+
+    std::vector<ibwt_partition_info> spans;
+    spans.reserve(anchors.size());
+    for (std::size_t i = 0; i < anchors.size(); ++i)
+    {
+        auto outputBegin = inputBegin + ((suffix_index)i << anchorIntervalShift);
+        auto outputEnd = (std::distance(outputBegin, inputEnd) > ((suffix_index)1 << anchorIntervalShift)) ? 
+                (outputBegin + ((suffix_index)1 << anchorIntervalShift)) : inputEnd;
+        spans.push_back({anchors[i], get_ibwt_index(index[anchors[i]]), get_next_ibwt_symbol(index.data(), anchors[i], symbolLookup),
+                outputBegin, outputBegin, outputEnd});
     }
 
-    std::copy(beginWrite, endWrite, inputBegin);
+    auto spansPerThread = ((spans.size() + numThreads - 1) / numThreads);
+    for (auto threadId = 0; threadId < numThreads; ++threadId)
+    {
+        auto spansBegin = std::min(spans.size(), threadId * spansPerThread);
+        auto spansEnd = std::min(spans.size(), spansBegin + spansPerThread);
+        post_task_to_thread(threadId, decode_ibwt_partitions<ibwt_entry>, index.data(), &symbolLookup, anchors[0], 
+                spans.data() + spansBegin, spans.data() + spansEnd);
+    }
+    wait_for_all_tasks_completed();
 }
 
+
+//==============================================================================
+template <typename ... argument_types>
+void maniscalco::msufsort::compact_reverse_burrows_wheeler_transform
+(
+    // private:
+    // the compact reverse transform using the narrowest packed index entry which can hold 
+    // every index of the input
+    uint8_t * inputBegin,
+    uint8_t * inputEnd,
+    argument_types const & ... arguments
+)
+{
+    auto inputSize = (std::uint64_t)std::distance(inputBegin, inputEnd);
+    if (inputSize <= ibwt_compact_entry<3>::max_index)
+        reverse_burrows_wheeler_transform<ibwt_compact_entry<3>>(inputBegin, inputEnd, arguments ...);
+    else if ((sizeof(suffix_index) <= 4) || (inputSize <= ibwt_compact_entry<4>::max_index))
+        reverse_burrows_wheeler_transform<ibwt_compact_entry<4>>(inputBegin, inputEnd, arguments ...);
+    else
+        reverse_burrows_wheeler_transform<ibwt_compact_entry<5>>(inputBegin, inputEnd, arguments ...);
+}
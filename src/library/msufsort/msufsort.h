@@ -28,11 +28,24 @@ SOFTWARE.
 #pragma once
 
 #include <vector>
+#include <deque>
 #include <stdint.h>
+#include <limits>
 #include <atomic>
 #include <thread>
 #include <memory>
+#include <memory_resource>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <iosfwd>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
 
 
 namespace maniscalco
@@ -42,15 +55,198 @@ namespace maniscalco
     {
     public:
 
+        // allocator which leaves trivial elements uninitialized upon construction.
+        // every entry of the suffix array is written by the sort so zero filling it is wasted.
+        template <typename T>
+        struct default_init_allocator : std::allocator<T>
+        {
+            template <typename U> 
+            struct rebind
+            {
+                using other = default_init_allocator<U>;
+            };
+
+            default_init_allocator() noexcept = default;
+
+            template <typename U> 
+            default_init_allocator
+            (
+                default_init_allocator<U> const &
+            ) noexcept
+            {
+            }
+
+            template <typename U> 
+            void construct
+            (
+                U * address
+            )
+            {
+                ::new ((void *)address) U;
+            }
+
+            template <typename U, typename ... argument_types>
+            void construct
+            (
+                U * address,
+                argument_types && ... arguments
+            )
+            {
+                ::new ((void *)address) U(std::forward<argument_types>(arguments) ...);
+            }
+        };
+
         static auto constexpr max_radix_size = (1 << 16);
-        using suffix_index = std::int32_t;
-        using suffix_array = std::vector<suffix_index>;
+        // the two high bits of each suffix index are reserved as flags.  the default 32 bit
+        // suffix index therefore limits input to 2^30 bytes.  define MSUFSORT_64_BIT_SUFFIX_INDEX
+        // (cmake -DMSUFSORT_64_BIT_SUFFIX_INDEX=ON) to build the engine with 64 bit suffix indexes.
+        #ifdef MSUFSORT_64_BIT_SUFFIX_INDEX
+            using suffix_index = std::int64_t;
+        #else
+            using suffix_index = std::int32_t;
+        #endif
+        using suffix_array = std::vector<suffix_index, default_init_allocator<suffix_index>>;
+        using pmr_suffix_array = std::pmr::vector<suffix_index>;
+
+        static suffix_index constexpr max_input_size = (std::numeric_limits<suffix_index>::max() >> 1);
+
+        // anchored transforms throw std::invalid_argument for an anchor interval shift outside
+        // of [0, max_anchor_interval_shift]
+        static std::int32_t constexpr max_anchor_interval_shift = ((8 * sizeof(suffix_index)) - 2);
+
+        // suffix indexes packed into five little endian bytes each.  for the 64 bit suffix index this
+        // is 5/8 the size of the suffix array for inputs of up to 2^40 bytes.  for the 32 bit suffix 
+        // index it is 5/4 the size so make_packed_suffix_array requires 64 bit suffix indexes.  the
+        // out of core writer still accepts the packed format with 32 bit suffix indexes so that its 
+        // output does not depend on the build.
+        static std::size_t constexpr packed_suffix_index_size = 5;
+
+        enum suffix_array_format
+        {
+            native_suffix_array_format,
+            packed_suffix_array_format
+        };
+
+        class packed_suffix_array
+        {
+        public:
+
+            // the storage is at least 'capacity' bytes so that it can first hold the suffix array
+            // which is then packed in place.  shrink_to_fit releases the storage beyond the packed size.
+            packed_suffix_array
+            (
+                std::size_t size = 0,
+                std::size_t capacity = 0
+            ):
+                size_(size),
+                data_((std::uint8_t *)std::malloc(std::max(capacity, (size * packed_suffix_index_size) + padding_size)))
+            {
+                if (!data_)
+                    throw std::bad_alloc();
+            }
+
+            void shrink_to_fit
+            (
+            )
+            {
+                if (auto data = (std::uint8_t *)std::realloc(data_.get(), (size_ * packed_suffix_index_size) + padding_size))
+                {
+                    data_.release();
+                    data_.reset(data);
+                }
+            }
+
+            suffix_index operator []
+            (
+                std::size_t index
+            ) const
+            {
+                std::uint64_t value;
+                std::memcpy(&value, data_.get() + (index * packed_suffix_index_size), sizeof(value));
+                return (suffix_index)(value & ((1ull << (packed_suffix_index_size * 8)) - 1));
+            }
+
+            // unpacks 'count' suffix indexes starting at 'index'
+            void unpack
+            (
+                std::size_t index,
+                std::size_t count,
+                suffix_index * output
+            ) const
+            {
+                unpack_suffix_indexes(data_.get() + (index * packed_suffix_index_size), count, output);
+            }
+
+            std::size_t size() const{return size_;}
+
+            std::uint8_t const * data() const{return data_.get();}
+
+            std::uint8_t * data(){return data_.get();}
+
+        private:
+
+            // the padding which follows the last index allows each index to be read with one eight byte load
+            static std::size_t constexpr padding_size = (sizeof(std::uint64_t) - packed_suffix_index_size);
+
+            struct free_deleter
+            {
+                void operator()(std::uint8_t * address) const{std::free(address);}
+            };
+
+            std::size_t                                     size_;
+            std::unique_ptr<std::uint8_t [], free_deleter>  data_;
+        };
+
+        // placement of the suffix array and bucket tables.  huge pages reduce the TLB misses
+        // caused by the random access of the second stage.  explicit huge pages fall back to
+        // transparent huge pages and then to standard pages if unavailable.  first touch places
+        // each page on the NUMA node of the (worker) thread which first writes it, whereas 
+        // interleave spreads the pages round robin across all permitted NUMA nodes and bind
+        // restricts the pages to the NUMA node of the thread which allocates them (suited to
+        // one instance per node).  the policy applies only to the memory which msufsort itself
+        // allocates and never to caller provided storage.
+        struct allocation_policy
+        {
+            enum page_type
+            {
+                standard_pages,
+                transparent_huge_pages,
+                explicit_huge_pages
+            };
+
+            enum numa_placement
+            {
+                first_touch,
+                interleave,
+                bind
+            };
+
+            page_type       pageType_;
+            numa_placement  numaPlacement_;
+        };
+
+        // speed/memory tradeoff of reverse_burrows_wheeler_transform.  the fast transform
+        // uses a suffix index plus the symbol per input byte (peak of 6n with 32 bit suffix
+        // indexes, 10n with 64 bit, counting the n byte input).  the compact transform keeps
+        // only the index, packed to 3 bytes for inputs under 8MB (4n), 4 bytes under 2GB (5n) 
+        // and 5 bytes beyond (6n), and finds each symbol from the symbol bucket boundaries instead.
+        enum reverse_transform_mode
+        {
+            fast_reverse_transform,
+            compact_reverse_transform
+        };
 
         msufsort
         (
             std::int32_t = 1
         );
 
+        msufsort
+        (
+            std::int32_t,
+            allocation_policy
+        );
+
         ~msufsort();
 
         suffix_array make_suffix_array
@@ -59,40 +255,247 @@ namespace maniscalco
             std::uint8_t const *
         );
 
-        int32_t forward_burrows_wheeler_transform
+        // caller provided storage must hold (inputSize + 1) suffix indexes
+        void make_suffix_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *,
+            suffix_index *
+        );
+
+        pmr_suffix_array make_suffix_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *,
+            std::pmr::memory_resource *
+        );
+
+        // out of core.  writes the (inputSize + 1) suffix indexes to the output stream, in host byte 
+        // order or packed, without holding the suffix array in memory.  the memory budget (in bytes) 
+        // bounds the ranks of a sample of the suffixes, which are held throughout, plus the suffixes 
+        // sorted at once.  the smaller the budget the sparser the sample and the more bytes are compared
+        // when sorting suffixes with long common prefixes.  throws std::invalid_argument if the budget
+        // can not hold the sparsest sample (about (1.25 * inputSize) bytes with 64 bit suffix indexes
+        // or (0.9 * inputSize) bytes with 32 bit suffix indexes).  the input itself may be a memory 
+        // mapped file.
+        void make_suffix_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *,
+            std::ostream &,
+            std::size_t,
+            suffix_array_format = native_suffix_array_format
+        );
+
+        packed_suffix_array make_packed_suffix_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *
+        );
+
+        // unpacks 'count' packed suffix indexes.  reads exactly (count * packed_suffix_index_size) bytes.
+        static void unpack_suffix_indexes
+        (
+            std::uint8_t const *,
+            std::size_t,
+            suffix_index *
+        );
+
+        // lcp array for a suffix array of (inputSize + 1) suffix indexes.  lcp[i] is the length of the
+        // longest common prefix of the suffixes at suffixArray[i - 1] and suffixArray[i].  lcp[0] is zero.
+        // the lcp array may be the suffix array itself, in which case the suffix array is overwritten.
+        void make_lcp_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *,
+            suffix_index const *,
+            suffix_index *
+        );
+
+        suffix_array make_lcp_array
+        (
+	        std::uint8_t const *,
+            std::uint8_t const *,
+            suffix_index const *
+        );
+
+        suffix_index forward_burrows_wheeler_transform
         (
 	        std::uint8_t *,
             std::uint8_t *
         );
 
+        // caller provided workspace must hold (inputSize + 1) suffix indexes
+        suffix_index forward_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            suffix_index *
+        );
+
+        suffix_index forward_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            std::pmr::memory_resource *
+        );
+
+        // also returns the anchors.  the sorted index of every (1 << anchorIntervalShift)'th suffix.
+        // anchors[0] is the sentinel index.
+        suffix_index forward_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            std::int32_t,
+            std::vector<suffix_index> &
+        );
+
+        void reverse_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            suffix_index,
+            reverse_transform_mode = fast_reverse_transform
+        );
+
+        static void reverse_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            suffix_index,
+            std::int32_t,
+            reverse_transform_mode = fast_reverse_transform
+        );
+
+        // reverses a transform made with anchors.  each span between anchors is decoded independently.
+        void reverse_burrows_wheeler_transform
+        (
+	        std::uint8_t *,
+            std::uint8_t *,
+            std::vector<suffix_index> const &,
+            std::int32_t,
+            reverse_transform_mode = fast_reverse_transform
+        );
+
         static void reverse_burrows_wheeler_transform
         (
 	        std::uint8_t *,
             std::uint8_t *,
+            std::vector<suffix_index> const &,
             std::int32_t,
-            std::int32_t
+            std::int32_t,
+            reverse_transform_mode = fast_reverse_transform
+        );
+
+        // block streaming transform.  the reader fills the buffer provided and returns the number of 
+        // bytes read (zero at the end of the stream).  it is called from a dedicated thread.  the writer 
+        // is called on the calling thread with each transformed block and its sentinel index, in order.
+        using block_reader = std::function<std::size_t(std::uint8_t *, std::size_t)>;
+        using block_writer = std::function<void(std::uint8_t const *, std::uint8_t const *, suffix_index)>;
+
+        static void forward_burrows_wheeler_transform_blocks
+        (
+            block_reader,
+            block_writer,
+            std::size_t,
+            std::int32_t = 1
+        );
+
+        static void forward_burrows_wheeler_transform_blocks
+        (
+            std::istream &,
+            block_writer,
+            std::size_t,
+            std::int32_t = 1
         );
  
     protected:
 
     private:
 
-        using suffix_value = std::uint32_t;
+        // the sort core (multikey quicksort and multikey insertion sort) is templated on the
+        // width of the key which it compares per recursion level.  suffix_value is the key used.
+        // define MSUFSORT_64_BIT_SORT_KEY to select eight byte keys rather than four byte keys.
+        #ifdef MSUFSORT_64_BIT_SORT_KEY
+            using suffix_value = std::uint64_t;
+        #else
+            using suffix_value = std::uint32_t;
+        #endif
+
+        // the widest supported key.  determines the size of the copy of the end of the input.
+        using max_suffix_value = std::uint64_t;
+
+        // the two high bits of a suffix index
+        static suffix_index constexpr high_bit_flag = std::numeric_limits<suffix_index>::min();
+        static suffix_index constexpr second_high_bit_flag = ((std::numeric_limits<suffix_index>::max() >> 1) + 1);
 
         // flags used in ISA
-        static std::int32_t constexpr is_induced_sort = 0x40000000;
-        static std::int32_t constexpr is_tandem_repeat_length  = 0x80000000;
-        static std::int32_t constexpr isa_flag_mask = is_induced_sort | is_tandem_repeat_length;  
-        static std::int32_t constexpr isa_index_mask = ~isa_flag_mask;
+        static suffix_index constexpr is_induced_sort = second_high_bit_flag;
+        static suffix_index constexpr is_tandem_repeat_length  = high_bit_flag;
+        static suffix_index constexpr isa_flag_mask = is_induced_sort | is_tandem_repeat_length;  
+        static suffix_index constexpr isa_index_mask = ~isa_flag_mask;
 
         // flags used in SA
-        static std::int32_t constexpr preceding_suffix_is_type_a_flag = 0x80000000;
-        static std::int32_t constexpr mark_isa_when_sorted = 0x40000000;
-        static std::int32_t constexpr sa_index_mask = ~(preceding_suffix_is_type_a_flag | mark_isa_when_sorted);
-        static std::int32_t constexpr suffix_is_unsorted_b_type = sa_index_mask;
+        static suffix_index constexpr preceding_suffix_is_type_a_flag = high_bit_flag;
+        static suffix_index constexpr mark_isa_when_sorted = second_high_bit_flag;
+        static suffix_index constexpr sa_index_mask = ~(preceding_suffix_is_type_a_flag | mark_isa_when_sorted);
+        static suffix_index constexpr suffix_is_unsorted_b_type = sa_index_mask;
+        // during the bwt left to right pass marks an anchor suffix in place of its symbol
+        static suffix_index constexpr suffix_is_anchor_flag = second_high_bit_flag;
+
+        static std::size_t constexpr huge_page_size = (1 << 21);
 
         static constexpr std::int32_t insertion_sort_threshold = 16;
-        static std::int32_t constexpr min_match_length_for_tandem_repeats = (2 + sizeof(suffix_value) + sizeof(suffix_value));
+
+        // number of suffixes ahead of each scan of the multikey quicksort partitioning loop 
+        // for which the text is prefetched
+        static std::int32_t constexpr multikey_quicksort_prefetch_distance = 16;
+
+        // define MSUFSORT_KEY_CACHE (cmake -DMSUFSORT_KEY_CACHE=ON) to partition those partitions of
+        // at least min_key_cache_partition_size and at most key_cache_size suffixes on a per thread cache
+        // of their keys (plus two entries read ahead by the partition loop).  relative to partitioning the
+        // suffixes directly (with prefetch) this helps some inputs (dna, random) but hurts others (text
+        // with long common prefixes).
+        #ifdef MSUFSORT_KEY_CACHE
+            static bool constexpr key_cache_enabled = true;
+        #else
+            static bool constexpr key_cache_enabled = false;
+        #endif
+        static std::size_t constexpr min_key_cache_partition_size = 0x400;
+        static std::size_t constexpr key_cache_size = 0x10000;
+        // partitions of at least this size are split on the next byte (or next two bytes once
+        // at least min_two_byte_radix_partition_size) by an in place radix sort before 
+        // multikey quicksort resumes on each of the resulting buckets.  radix sorting only pays
+        // off when the digit takes many distinct values (a sample of radix_sample_size suffixes
+        // must hold at least min_radix_distinct_digits) since the quicksort compares a full key per level.
+        static std::size_t constexpr min_radix_partition_size = 0x4000;
+        static std::size_t constexpr min_two_byte_radix_partition_size = 0x100000;
+        static std::size_t constexpr radix_sample_size = 0x100;
+        static std::size_t constexpr min_radix_distinct_digits = 0x40;
+
+        // the initial radix sort is widened from two bytes to three bytes for those two byte partitions
+        // which are skewed.  that is, which hold at least min_radix_partition_size B* suffixes and at least
+        // 1 / (1 << three_byte_radix_partition_shift) of all B* suffixes, and whose sampled third bytes
+        // take at least min_radix_distinct_digits distinct values.
+        static std::int32_t constexpr three_byte_radix_partition_shift = 12;
+
+        template <typename key_type>
+        static std::int32_t constexpr min_match_length_for_tandem_repeats = (2 + sizeof(key_type) + sizeof(key_type));
+
+        // the direct sort charges its work on deep (repetitive) partitions against a budget
+        // proportional to the input size.  once exhausted, first_stage_its() abandons the 
+        // direct sort and orders the B* suffixes with induced sorting instead.
+        static std::int32_t constexpr direct_sort_budget_per_byte = 16;
+        static std::int32_t constexpr direct_sort_budget_min_match_length = 64;
+
+        // sub partitions of at least this size are made available to other threads rather than
+        // being sorted by the thread which produced them.  this keeps all threads busy when a
+        // single two byte partition holds most of the B* suffixes.
+        static suffix_index constexpr min_parallel_partition_size = 0x10000;
+
+        // block streaming transforms a block on one more thread for each multiple of this size.
+        // smaller blocks are each transformed on a single thread with several blocks at once.
+        static std::size_t constexpr min_block_size_per_thread = (1 << 22);
 
         enum suffix_type 
         {
@@ -107,8 +510,8 @@ namespace maniscalco
             (
                 suffix_index * partitionBegin,
                 suffix_index * partitionEnd,
-                std::int32_t numTerminators,
-                std::int32_t tandemRepeatLength
+                suffix_index numTerminators,
+                suffix_index tandemRepeatLength
             ):
                 partitionBegin_(partitionBegin),
                 partitionEnd_(partitionEnd),
@@ -119,11 +522,18 @@ namespace maniscalco
 
             suffix_index *  partitionBegin_;
             suffix_index *  partitionEnd_;
-            std::int32_t    numTerminators_;
-            std::int32_t    tandemRepeatLength_;
+            suffix_index    numTerminators_;
+            suffix_index    tandemRepeatLength_;
         };
 
-        suffix_value get_value
+        template <typename key_type>
+        key_type get_value
+        (
+            uint8_t const *,
+            suffix_index
+        ) const;
+
+        void prefetch_value
         (
             uint8_t const *,
             suffix_index
@@ -134,6 +544,95 @@ namespace maniscalco
             uint8_t const *
         );
 
+        using store_symbols_function = void (*)(suffix_index const *, suffix_index const *, std::uint8_t *);
+
+        static store_symbols_function select_store_symbols_function();
+
+        static void store_symbols
+        (
+            suffix_index const *,
+            suffix_index const *,
+            std::uint8_t *
+        );
+
+        static void store_symbols_scalar
+        (
+            suffix_index const *,
+            suffix_index const *,
+            std::uint8_t *
+        );
+
+        static void store_symbols_sse2
+        (
+            suffix_index const *,
+            suffix_index const *,
+            std::uint8_t *
+        );
+
+        static void pack_suffix_indexes
+        (
+            suffix_index const *,
+            suffix_index const *,
+            std::uint8_t *
+        );
+
+        using unpack_suffix_indexes_function = void (*)(std::uint8_t const *, std::size_t, suffix_index *);
+
+        static unpack_suffix_indexes_function select_unpack_suffix_indexes_function();
+
+        static void unpack_suffix_indexes_scalar
+        (
+            std::uint8_t const *,
+            std::size_t,
+            suffix_index *
+        );
+
+        static void unpack_suffix_indexes_ssse3
+        (
+            std::uint8_t const *,
+            std::size_t,
+            suffix_index *
+        );
+
+        static void unpack_suffix_indexes_avx2
+        (
+            std::uint8_t const *,
+            std::size_t,
+            suffix_index *
+        );
+
+        using match_length_function = std::size_t (*)(std::uint8_t const *, std::uint8_t const *, std::size_t);
+
+        static match_length_function select_match_length_function();
+
+        static std::size_t match_length
+        (
+            std::uint8_t const *,
+            std::uint8_t const *,
+            std::size_t
+        );
+
+        static std::size_t match_length_scalar
+        (
+            std::uint8_t const *,
+            std::uint8_t const *,
+            std::size_t
+        );
+
+        static std::size_t match_length_sse2
+        (
+            std::uint8_t const *,
+            std::uint8_t const *,
+            std::size_t
+        );
+
+        static std::size_t match_length_avx2
+        (
+            std::uint8_t const *,
+            std::uint8_t const *,
+            std::size_t
+        );
+
         bool compare_suffixes
         (
             std::uint8_t const *,
@@ -157,13 +656,14 @@ namespace maniscalco
             uint64_t
         );
 
+        template <typename key_type>
         void multikey_insertion_sort
         (
             suffix_index *,
             suffix_index *,
-            std::int32_t,
-            suffix_value,
-            std::array<suffix_value, 2>,
+            suffix_index,
+            key_type,
+            std::array<key_type, 2>,
             std::vector<tandem_repeat_info> &
         );
 
@@ -171,7 +671,7 @@ namespace maniscalco
         (
             suffix_index *,
             suffix_index *,
-            std::int32_t,
+            suffix_index,
             std::vector<tandem_repeat_info> &
         );
 
@@ -179,7 +679,7 @@ namespace maniscalco
         (
             uint8_t const *,
             uint8_t const *,
-            std::array<int32_t *, 4>
+            std::array<suffix_index *, 4>
         );
 
         template <typename F, typename ... argument_types>
@@ -194,7 +694,7 @@ namespace maniscalco
 
         void second_stage_its();
 
-        int32_t second_stage_its_as_burrows_wheeler_transform();
+        suffix_index second_stage_its_as_burrows_wheeler_transform();
 
         void second_stage_its_right_to_left_pass_single_threaded();
 
@@ -206,64 +706,330 @@ namespace maniscalco
 
         void second_stage_its_as_burrows_wheeler_transform_right_to_left_pass_single_threaded();
 
-        int32_t second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_single_threaded();
+        suffix_index second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_single_threaded();
 
         void second_stage_its_as_burrows_wheeler_transform_right_to_left_pass_multi_threaded();
 
-        int32_t second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_multi_threaded();
-
-        void first_stage_its();
+        suffix_index second_stage_its_as_burrows_wheeler_transform_left_to_right_pass_multi_threaded();
 
-        suffix_index * multikey_quicksort
+        void * allocate_pages
         (
-            suffix_index *,
-            suffix_index *,
-            std::int32_t,
-            suffix_value,
-            std::array<suffix_value, 2>,
-            std::vector<tandem_repeat_info> &
-        );
+            std::size_t
+        ) const;
 
-        void initial_two_byte_radix_sort
+        void release_pages
         (
-            uint8_t const *,
-            uint8_t const *,
-            int32_t *
-        );
+            void *,
+            std::size_t
+        ) const;
 
-        bool has_potential_tandem_repeats
+        void apply_allocation_policy
         (
-            suffix_value,
-            std::array<suffix_value, 2>
+            void *,
+            std::size_t
         ) const;
 
-        void complete_tandem_repeats
+        void initialize
         (
-            std::vector<tandem_repeat_info> &
+            std::uint8_t const *,
+            std::uint8_t const *,
+            suffix_index *
         );
 
-        void complete_tandem_repeat
-        (
-            suffix_index *,
-            suffix_index *,
-            std::int32_t,
-            std::int32_t
-        );
+        void first_stage_its();
 
-        struct ibwt_partition_info
-        {
-            ibwt_partition_info(){}
+        bool direct_sort_abandoned() const;
+
+        bool charge_direct_sort_budget
+        (
+            std::int64_t
+        ) const;
+
+        void induced_sort_b_star_suffixes();
+
+        template <typename symbol_type>
+        static void induced_sort
+        (
+            symbol_type const *,
+            suffix_index *,
+            suffix_index,
+            suffix_index,
+            suffix_index * = nullptr,
+            suffix_index = 0
+        );
+
+        template <typename key_type>
+        struct partition_task
+        {
+            suffix_index *              partitionBegin_;
+            suffix_index *              partitionEnd_;
+            suffix_index                matchLength_;
+            key_type                    startingPattern_;
+            std::array<key_type, 2>     endingPattern_;
+        };
+
+        // work stealing deque of partitions awaiting multikey quicksort.  the owning thread
+        // pushes and pops at the back while other threads steal the oldest (largest) from the front.
+        template <typename key_type>
+        class partition_task_deque
+        {
+        public:
+
+            void push
+            (
+                partition_task<key_type> const & partitionTask
+            )
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                partitionTasks_.push_back(partitionTask);
+            }
+
+            bool pop
+            (
+                partition_task<key_type> & partitionTask
+            )
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (partitionTasks_.empty())
+                    return false;
+                partitionTask = partitionTasks_.back();
+                partitionTasks_.pop_back();
+                return true;
+            }
+
+            bool steal
+            (
+                partition_task<key_type> & partitionTask
+            )
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (partitionTasks_.empty())
+                    return false;
+                partitionTask = partitionTasks_.front();
+                partitionTasks_.pop_front();
+                return true;
+            }
+
+        private:
+
+            std::mutex mutex_;
+            std::deque<partition_task<key_type>> partitionTasks_;
+        };
+
+        template <typename key_type>
+        struct cached_key
+        {
+            key_type        value_;
+            suffix_index    index_;
+        };
+
+        template <typename key_type>
+        struct seven_way_partition
+        {
+            std::array<std::size_t, 6>  boundaries_;
+            std::array<key_type, 3>     pivots_;
+        };
+
+        template <typename key_type, typename element_type, typename get_key_function, typename prefetch_function>
+        seven_way_partition<key_type> partition_seven_ways
+        (
+            element_type *,
+            element_type *,
+            get_key_function,
+            prefetch_function
+        );
+
+        template <typename digit_type>
+        std::size_t count_sampled_distinct_digits
+        (
+            suffix_index const *,
+            suffix_index const *,
+            uint8_t const *
+        ) const;
+
+        template <typename digit_type>
+        std::vector<suffix_index> radix_partition
+        (
+            suffix_index *,
+            suffix_index *,
+            uint8_t const *
+        );
+
+        template <typename key_type>
+        void post_partition_task
+        (
+            partition_task_deque<key_type> &,
+            partition_task<key_type> const &
+        );
+
+        template <typename key_type>
+        suffix_index * multikey_quicksort
+        (
+            suffix_index *,
+            suffix_index *,
+            suffix_index,
+            key_type,
+            std::array<key_type, 2>,
+            std::vector<tandem_repeat_info> &,
+            partition_task_deque<key_type> * = nullptr,
+            cached_key<key_type> * = nullptr
+        );
+
+        void initial_two_byte_radix_sort
+        (
+            uint8_t const *,
+            uint8_t const *,
+            suffix_index *
+        );
+
+        template <typename key_type>
+        bool has_potential_tandem_repeats
+        (
+            key_type,
+            std::array<key_type, 2>
+        ) const;
+
+        void complete_tandem_repeats
+        (
+            std::vector<tandem_repeat_info> &
+        );
+
+        struct out_of_core_entry
+        {
+            std::uint64_t   prefix_;
+            suffix_index    index_;
+        };
+
+        // ranks of the suffixes which begin at a difference cover sample of the input positions.
+        // the cover of the positions modulo coverSize_ (coverRoot_ squared) is the residues
+        // [0, coverRoot_] and the multiples of coverRoot_.  for any two suffixes there is an offset
+        // less than coverSize_ at which both are in the sample so any two suffixes which share
+        // their first coverSize_ bytes are ordered by the ranks of the sample suffixes at that offset.
+        // rank_ holds the ranks of each covered residue in input order and residueBegin_ holds where
+        // each covered residue, in order, begins in rank_.
+        struct out_of_core_sample
+        {
+            suffix_index                coverRoot_;
+            suffix_index                coverSize_;
+            std::vector<suffix_index>   residueBegin_;
+            std::vector<suffix_index>   rank_;
+        };
+
+        // the sparsest cover tried.  its sample is about (1 / 32) of the input positions.  sparser
+        // covers would need less memory but compare up to coverSize bytes per suffix per pass on
+        // repetitive input.
+        static suffix_index constexpr max_out_of_core_cover_root = 64;
+
+        // the densest cover tried.  denser covers cost more memory but fewer bytes are compared
+        // before the sample ranks can order two suffixes.
+        static suffix_index constexpr min_out_of_core_cover_root = 16;
+
+        static std::size_t get_out_of_core_sample_size
+        (
+            suffix_index,
+            suffix_index
+        );
+
+        std::uint64_t get_padded_prefix
+        (
+            suffix_index
+        ) const;
+
+        void make_out_of_core_sample
+        (
+            suffix_index,
+            out_of_core_sample &
+        );
+
+        suffix_index get_out_of_core_rank
+        (
+            suffix_index,
+            out_of_core_sample const &
+        ) const;
+
+        bool compare_out_of_core_suffixes
+        (
+            suffix_index,
+            suffix_index,
+            suffix_index,
+            out_of_core_sample const &
+        ) const;
+
+        bool out_of_core_prefixes_match
+        (
+            suffix_index,
+            suffix_index,
+            suffix_index
+        ) const;
+
+        void sort_out_of_core_entries
+        (
+            out_of_core_entry *,
+            out_of_core_entry *,
+            out_of_core_sample const &
+        ) const;
+
+        template <typename classify_function, typename split_function>
+        void make_suffix_array_out_of_core
+        (
+            classify_function,
+            std::int32_t,
+            split_function,
+            std::size_t,
+            std::ostream &,
+            suffix_array_format,
+            std::vector<out_of_core_entry> &,
+            out_of_core_sample const &
+        );
+
+        void make_suffix_array_out_of_core
+        (
+            std::uint64_t,
+            std::int32_t,
+            std::size_t,
+            std::ostream &,
+            suffix_array_format,
+            std::vector<out_of_core_entry> &,
+            out_of_core_sample const &
+        );
+
+        void split_out_of_core_bucket
+        (
+            std::uint64_t,
+            suffix_index,
+            suffix_index,
+            std::size_t,
+            std::size_t,
+            std::ostream &,
+            suffix_array_format,
+            std::vector<out_of_core_entry> &,
+            out_of_core_sample const &
+        );
+
+        void complete_tandem_repeat
+        (
+            suffix_index *,
+            suffix_index *,
+            suffix_index,
+            suffix_index
+        );
+
+        struct ibwt_partition_info
+        {
+            ibwt_partition_info(){}
 
             ibwt_partition_info
             (
                 suffix_index startIndex,
                 suffix_index currentIndex,
+                std::uint8_t symbol,
                 std::uint8_t * beginOutput,
                 std::uint8_t * currentOutput,
                 std::uint8_t * endOutput
             ):
                 startIndex_(startIndex),
                 currentIndex_(currentIndex),
+                symbol_(symbol),
                 beginOutput_(beginOutput),
                 currentOutput_(currentOutput),
                 endOutput_(endOutput)
@@ -272,22 +1038,176 @@ namespace maniscalco
 
             suffix_index startIndex_;
             suffix_index currentIndex_;
+            std::uint8_t symbol_;
             std::uint8_t * beginOutput_;
             std::uint8_t * currentOutput_;
             std::uint8_t * endOutput_;
         };
 
-        uint8_t const * inputBegin_;
+        // the reverse transform index entries.  ibwt_symbol_entry carries the symbol at the
+        // entry's index whereas ibwt_compact_entry leaves it to be found with ibwt_symbol_lookup.
+        // ibwt_compact_entry stores the index in 'width' little endian bytes with the partition 
+        // start flag as the high bit so the largest index it can hold is max_index.
+        #pragma pack(push, 1)
+        struct ibwt_symbol_entry
+        {
+            suffix_index    value_;
+            std::uint8_t    symbol_;
+        };
 
-        uint8_t const * inputEnd_;
+        template <std::size_t width>
+        struct ibwt_compact_entry
+        {
+            static std::uint64_t constexpr max_index = (((std::uint64_t)1 << ((width << 3) - 1)) - 1);
+            std::uint8_t    value_[width];
+        };
+        #pragma pack(pop)
 
-        int32_t         inputSize_;
+        // finds the symbol (first column) of any index from the symbol bucket boundaries.  the
+        // symbol at the start of each block of (1 << ibwt_symbol_block_shift) indexes is kept
+        // so that at most a few bucket boundaries are then tested.
+        static std::int32_t constexpr ibwt_symbol_block_shift = 8;
 
-        uint8_t const * getValueEnd_;
+        struct ibwt_symbol_lookup
+        {
+            suffix_index                bucketBegin_[0x101];
+            std::vector<std::uint8_t>   blockSymbol_;
+        };
 
-        suffix_index    getValueMaxIndex_;
+        static void set_ibwt_entry
+        (
+            ibwt_symbol_entry &,
+            suffix_index,
+            std::uint8_t
+        );
+
+        template <std::size_t width>
+        static void set_ibwt_entry
+        (
+            ibwt_compact_entry<width> &,
+            suffix_index,
+            std::uint8_t
+        );
+
+        static suffix_index get_ibwt_index
+        (
+            ibwt_symbol_entry const &
+        );
+
+        template <std::size_t width>
+        static suffix_index get_ibwt_index
+        (
+            ibwt_compact_entry<width> const &
+        );
+
+        static void set_ibwt_partition_start
+        (
+            ibwt_symbol_entry &
+        );
+
+        template <std::size_t width>
+        static void set_ibwt_partition_start
+        (
+            ibwt_compact_entry<width> &
+        );
+
+        static std::uint8_t get_ibwt_symbol
+        (
+            ibwt_symbol_entry const *,
+            suffix_index,
+            std::uint8_t
+        );
 
-        uint8_t         copyEnd_[sizeof(suffix_value) << 1];
+        template <std::size_t width>
+        static std::uint8_t get_ibwt_symbol
+        (
+            ibwt_compact_entry<width> const *,
+            suffix_index,
+            std::uint8_t
+        );
+
+        static std::uint8_t get_next_ibwt_symbol
+        (
+            ibwt_symbol_entry const *,
+            suffix_index,
+            ibwt_symbol_lookup const &
+        );
+
+        template <std::size_t width>
+        static std::uint8_t get_next_ibwt_symbol
+        (
+            ibwt_compact_entry<width> const *,
+            suffix_index,
+            ibwt_symbol_lookup const &
+        );
+
+        // high bit of an index marks the start of a decode partition
+        static suffix_index constexpr ibwt_partition_start_flag = std::numeric_limits<suffix_index>::min();
+        static suffix_index constexpr ibwt_partition_index_mask = ~ibwt_partition_start_flag;
+
+        template <typename ibwt_entry>
+        void build_ibwt_index
+        (
+            std::uint8_t const *,
+            std::uint8_t const *,
+            suffix_index,
+            std::vector<ibwt_entry> &,
+            ibwt_symbol_lookup &
+        );
+
+        template <typename ibwt_entry>
+        static void decode_ibwt_partitions
+        (
+            ibwt_entry const *,
+            ibwt_symbol_lookup const *,
+            suffix_index,
+            ibwt_partition_info *,
+            ibwt_partition_info *
+        );
+
+        template <typename ibwt_entry>
+        void reverse_burrows_wheeler_transform
+        (
+            std::uint8_t *,
+            std::uint8_t *,
+            suffix_index
+        );
+
+        template <typename ibwt_entry>
+        void reverse_burrows_wheeler_transform
+        (
+            std::uint8_t *,
+            std::uint8_t *,
+            std::vector<suffix_index> const &,
+            std::int32_t
+        );
+
+        template <typename ... argument_types>
+        void compact_reverse_burrows_wheeler_transform
+        (
+            std::uint8_t *,
+            std::uint8_t *,
+            argument_types const & ...
+        );
+
+        bool is_anchor
+        (
+            suffix_index
+        ) const;
+
+        void record_anchor
+        (
+            suffix_index,
+            suffix_index const *
+        );
+
+        uint8_t const * inputBegin_;
+
+        uint8_t const * inputEnd_;
+
+        suffix_index    inputSize_;
+
+        uint8_t         copyEnd_[sizeof(max_suffix_value) << 1];
 
         suffix_index *  suffixArrayBegin_;
 
@@ -299,14 +1219,40 @@ namespace maniscalco
 
         suffix_index *  frontBucketOffset_[0x100];
 
-        std::unique_ptr<suffix_index * []>  backBucketOffset_;
+        allocation_policy const allocationPolicy_;
+
+        suffix_index ** backBucketOffset_;
+
+        suffix_index    aCount_[0x100];
+
+        suffix_index    bCount_[0x100];
 
-        int32_t         aCount_[0x100];
+        // when not null the bwt records the sorted index of each suffix whose index is a 
+        // multiple of (anchorIntervalMask_ + 1) here
+        suffix_index *  anchors_;
 
-        int32_t         bCount_[0x100];
+        suffix_index    anchorIntervalMask_;
+
+        std::int32_t    anchorIntervalShift_;
 
         bool const      tandemRepeatSortEnabled_ = true;
 
+        std::atomic<std::int64_t> mutable directSortBudget_;
+
+        std::atomic<std::int64_t> unfinishedPartitionTasks_;
+
+        // threads without a partition task to sort park on partitionTaskCondition_ until a task is
+        // shared (queuedPartitionTasks_), the sort completes or the direct sort is abandoned.
+        std::atomic<std::int64_t> queuedPartitionTasks_;
+
+        std::atomic<std::int32_t> idlePartitionThreads_;
+
+        std::mutex                partitionTaskMutex_;
+
+        std::condition_variable   partitionTaskCondition_;
+
+        // worker threads spin briefly when idle to keep hand off latency low and then park
+        // on a condition variable so that idle workers cost nothing between tasks.
         class worker_thread
         {
         public:
@@ -317,26 +1263,12 @@ namespace maniscalco
                 thread_(), 
                 task_(), 
                 terminate_(false),
-                taskCompleted_(true)
+                taskCompleted_(true),
+                mutex_(),
+                taskPostedCondition_(),
+                taskCompletedCondition_()
             {
-                auto workFunction = []
-                (
-                    std::function<void()> & task,
-                    bool volatile & taskComplete,
-                    bool volatile & terminate
-                )
-                {
-                    while (taskComplete)
-                        ;
-                    while (!terminate)
-                    {
-                        task();
-                        taskComplete = true;
-                        while (taskComplete)
-                            ;
-                    } 
-                };
-                thread_ = std::thread(workFunction, std::ref(task_), std::ref(taskCompleted_), std::ref(terminate_));
+                thread_ = std::thread(&worker_thread::work, this);
             }
 
             ~worker_thread
@@ -351,8 +1283,8 @@ namespace maniscalco
             (
             )
             {
-                terminate_ = true;
-                taskCompleted_ = false;
+                terminate_.store(true);
+                signal_task_posted();
             }
 
             template <typename ... argument_types>
@@ -362,23 +1294,83 @@ namespace maniscalco
             )
             {
                 task_ = std::bind(std::forward<argument_types>(arguments) ...);
-                taskCompleted_ = false;
+                signal_task_posted();
             }
 
             inline void wait
             (
             ) const
             {
-                while (!taskCompleted_)
-                    ;
+                if (spin_until([this](){return taskCompleted_.load(std::memory_order_acquire);}))
+                    return;
+                std::unique_lock<std::mutex> lock(mutex_);
+                taskCompletedCondition_.wait(lock, [this](){return taskCompleted_.load(std::memory_order_acquire);});
             }
 
         private:
 
+            static std::int32_t constexpr max_spin_count = 0x400;
+
+            template <typename predicate_type>
+            static bool spin_until
+            (
+                predicate_type predicate
+            )
+            {
+                for (auto i = 0; i < max_spin_count; ++i)
+                {
+                    if (predicate())
+                        return true;
+                    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+                        _mm_pause();
+                    #else
+                        std::this_thread::yield();
+                    #endif
+                }
+                return false;
+            }
+
+            void signal_task_posted
+            (
+            )
+            {
+                taskCompleted_.store(false, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                }
+                taskPostedCondition_.notify_one();
+            }
+
+            void work
+            (
+            )
+            {
+                auto taskPending = [this](){return !taskCompleted_.load(std::memory_order_acquire);};
+                while (true)
+                {
+                    if (!spin_until(taskPending))
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        taskPostedCondition_.wait(lock, taskPending);
+                    }
+                    if (terminate_.load())
+                        break;
+                    task_();
+                    taskCompleted_.store(true, std::memory_order_release);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                    }
+                    taskCompletedCondition_.notify_all();
+                } 
+            }
+
             std::thread thread_;
             std::function<void()> task_;
-            bool volatile terminate_;
-            bool volatile taskCompleted_;
+            std::atomic<bool> terminate_;
+            std::atomic<bool> taskCompleted_;
+            std::mutex mutable mutex_;
+            std::condition_variable taskPostedCondition_;
+            std::condition_variable mutable taskCompletedCondition_;
         };
 
 
@@ -398,22 +1390,118 @@ namespace maniscalco
     );
 
     template <typename input_iter>
-    int32_t forward_burrows_wheeler_transform
+    void make_suffix_array
     (
         input_iter,
         input_iter,
+        msufsort::suffix_index *,
         int32_t = 1
     );
 
     template <typename input_iter>
-    static void reverse_burrows_wheeler_transform
+    msufsort::pmr_suffix_array make_suffix_array
+    (
+        input_iter,
+        input_iter,
+        std::pmr::memory_resource *,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    void make_suffix_array
+    (
+        input_iter,
+        input_iter,
+        std::ostream &,
+        std::size_t,
+        int32_t = 1,
+        msufsort::suffix_array_format = msufsort::native_suffix_array_format
+    );
+
+    template <typename input_iter>
+    msufsort::packed_suffix_array make_packed_suffix_array
+    (
+        input_iter,
+        input_iter,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    msufsort::suffix_array make_lcp_array
+    (
+        input_iter,
+        input_iter,
+        msufsort::suffix_index const *,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    void make_lcp_array
+    (
+        input_iter,
+        input_iter,
+        msufsort::suffix_index const *,
+        msufsort::suffix_index *,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    msufsort::suffix_index forward_burrows_wheeler_transform
+    (
+        input_iter,
+        input_iter,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    msufsort::suffix_index forward_burrows_wheeler_transform
+    (
+        input_iter,
+        input_iter,
+        msufsort::suffix_index *,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    msufsort::suffix_index forward_burrows_wheeler_transform
+    (
+        input_iter,
+        input_iter,
+        std::pmr::memory_resource *,
+        int32_t = 1
+    );
+
+    template <typename input_iter>
+    msufsort::suffix_index forward_burrows_wheeler_transform
     (
         input_iter,
         input_iter,
         int32_t,
+        std::vector<msufsort::suffix_index> &,
         int32_t = 1
     );
 
+    template <typename input_iter>
+    static void reverse_burrows_wheeler_transform
+    (
+        input_iter,
+        input_iter,
+        msufsort::suffix_index,
+        int32_t = 1,
+        msufsort::reverse_transform_mode = msufsort::fast_reverse_transform
+    );
+
+    template <typename input_iter>
+    static void reverse_burrows_wheeler_transform
+    (
+        input_iter,
+        input_iter,
+        std::vector<msufsort::suffix_index> const &,
+        int32_t,
+        int32_t = 1,
+        msufsort::reverse_transform_mode = msufsort::fast_reverse_transform
+    );
+
 } // namespace maniscalco
 
 
@@ -436,7 +1524,117 @@ maniscalco::msufsort::suffix_array maniscalco::make_suffix_array
 
 //==============================================================================
 template <typename input_iter>
-int32_t maniscalco::forward_burrows_wheeler_transform
+void maniscalco::make_suffix_array
+(
+    input_iter begin,
+    input_iter end,
+    msufsort::suffix_index * suffixArray,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort(numThreads).make_suffix_array((uint8_t const *)&*begin, (uint8_t const *)&*end, suffixArray);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::pmr_suffix_array maniscalco::make_suffix_array
+(
+    input_iter begin,
+    input_iter end,
+    std::pmr::memory_resource * memoryResource,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).make_suffix_array((uint8_t const *)&*begin, (uint8_t const *)&*end, memoryResource);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+void maniscalco::make_suffix_array
+(
+    input_iter begin,
+    input_iter end,
+    std::ostream & outputStream,
+    std::size_t memoryBudget,
+    int32_t numThreads,
+    msufsort::suffix_array_format suffixArrayFormat
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort(numThreads).make_suffix_array((uint8_t const *)&*begin, (uint8_t const *)&*end, outputStream, memoryBudget, suffixArrayFormat);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::packed_suffix_array maniscalco::make_packed_suffix_array
+(
+    input_iter begin,
+    input_iter end,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).make_packed_suffix_array((uint8_t const *)&*begin, (uint8_t const *)&*end);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::suffix_array maniscalco::make_lcp_array
+(
+    input_iter begin,
+    input_iter end,
+    msufsort::suffix_index const * suffixArray,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).make_lcp_array((uint8_t const *)&*begin, (uint8_t const *)&*end, suffixArray);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+void maniscalco::make_lcp_array
+(
+    input_iter begin,
+    input_iter end,
+    msufsort::suffix_index const * suffixArray,
+    msufsort::suffix_index * lcpArray,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort(numThreads).make_lcp_array((uint8_t const *)&*begin, (uint8_t const *)&*end, suffixArray, lcpArray);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::suffix_index maniscalco::forward_burrows_wheeler_transform
 (
     input_iter begin,
     input_iter end,
@@ -451,15 +1649,95 @@ int32_t maniscalco::forward_burrows_wheeler_transform
 }
 
 
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::suffix_index maniscalco::forward_burrows_wheeler_transform
+(
+    input_iter begin,
+    input_iter end,
+    msufsort::suffix_index * workspace,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).forward_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, workspace);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::suffix_index maniscalco::forward_burrows_wheeler_transform
+(
+    input_iter begin,
+    input_iter end,
+    std::pmr::memory_resource * memoryResource,
+    int32_t numThreads
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).forward_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, memoryResource);
+}
+
+
 //==============================================================================
 template <typename input_iter>
 void maniscalco::reverse_burrows_wheeler_transform
 (
     input_iter begin,
     input_iter end,
-    int32_t sentinelIndex,
+    msufsort::suffix_index sentinelIndex,
+    int32_t numThreads,
+    msufsort::reverse_transform_mode reverseTransformMode
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort::reverse_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, sentinelIndex, numThreads, reverseTransformMode);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+maniscalco::msufsort::suffix_index maniscalco::forward_burrows_wheeler_transform
+(
+    input_iter begin,
+    input_iter end,
+    int32_t anchorIntervalShift,
+    std::vector<msufsort::suffix_index> & anchors,
     int32_t numThreads
 )
 {
-    msufsort::reverse_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, sentinelIndex, numThreads);
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    return msufsort(numThreads).forward_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, anchorIntervalShift, anchors);
+}
+
+
+//==============================================================================
+template <typename input_iter>
+void maniscalco::reverse_burrows_wheeler_transform
+(
+    input_iter begin,
+    input_iter end,
+    std::vector<msufsort::suffix_index> const & anchors,
+    int32_t anchorIntervalShift,
+    int32_t numThreads,
+    msufsort::reverse_transform_mode reverseTransformMode
+)
+{
+    if (numThreads <= 0)
+        numThreads = 1;
+    if (numThreads > (int32_t)std::thread::hardware_concurrency())
+        numThreads = (int32_t)std::thread::hardware_concurrency();
+    msufsort::reverse_burrows_wheeler_transform((uint8_t *)&*begin, (uint8_t *)&*end, anchors, anchorIntervalShift, numThreads, reverseTransformMode);
 }